@@ -0,0 +1,542 @@
+/** @file distribution.c
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+
+#include "distribution.h"
+
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+
+/* - - - - - - - - - - - - */
+/*    DS_RANDOM FUNCTIONS  */
+/* - - - - - - - - - - - - */
+// Random number generator with explicit state, so every generator can be seeded and replayed independently
+
+/* Error messages aren't printed if it's set, the library reports errors only by status codes (process local) */
+bool DS_Quiet = false;
+
+/**
+ * Seeds the random number generator. Two generators with the same seed generate the same sequence.
+ *
+ * @param rng Pointer to the random number generator
+ * @param seed Seed of the generator
+ */
+void DS_RandomSeed(DSRandom *rng, unsigned long seed)
+{
+    rng->xsubi[0] = 0x330E;
+    rng->xsubi[1] = (unsigned short)(seed & 0xFFFF);
+    rng->xsubi[2] = (unsigned short)((seed >> 16) & 0xFFFF);
+}
+
+/**
+ * Mixes all bits of the value (splitmix64 finalizer), neighbouring values give unrelated results.
+ *
+ * @param value Value to be mixed
+ * @return uint64_t Mixed value
+ */
+static uint64_t DS_RandomMix(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+/**
+ * Seeds the random number generator of one stream of the seed. Seeding erand48() by adjacent numbers gives first
+ * numbers which differ by a constant step, so the seed and the stream are mixed into all 48 bits of the state.
+ *
+ * @param rng Pointer to the random number generator
+ * @param seed Seed shared by all streams of the run
+ * @param kind Kind of the stream (customer, officer)
+ * @param id Number of the stream, process number of the customer or officer
+ */
+void DS_RandomSeedStream(DSRandom *rng, unsigned long seed, DSStream kind, unsigned int id)
+{
+    uint64_t state = DS_RandomMix(DS_RandomMix((uint64_t)seed) ^ ((uint64_t)kind << 32 | id));
+    rng->xsubi[0] = (unsigned short)(state & 0xFFFF);
+    rng->xsubi[1] = (unsigned short)((state >> 16) & 0xFFFF);
+    rng->xsubi[2] = (unsigned short)((state >> 32) & 0xFFFF);
+}
+
+/**
+ * Returns random number in interval <0, 1).
+ *
+ * @param rng Pointer to the random number generator
+ * @return double Random number
+ */
+double DS_RandomUniform(DSRandom *rng)
+{
+    return erand48(rng->xsubi);
+}
+
+/**
+ * Returns exponentialy distributed random number (inverse CDF of exponential distribution).
+ *
+ * @param rng Pointer to the random number generator
+ * @param rate Rate of the distribution (1 / mean)
+ * @return double Random number
+ */
+double DS_RandomExp(DSRandom *rng, double rate)
+{
+    return -log(1.0 - DS_RandomUniform(rng)) / rate;
+}
+
+
+
+/* - - - - - - - - - - - - - */
+/*   DS_ARRIVAL FUNCTIONS    */
+/* - - - - - - - - - - - - - */
+// Customer arrival processes, the init process asks for the next inter-arrival time and spawns the customer
+
+/**
+ * Parses one number from the trace file, skips lines which don't start with a number. Trace file
+ * isn't null terminated, so strtod() can't be used.
+ *
+ * @param arrival Pointer to arrival process with mapped trace
+ * @param value (return) Parsed inter-arrival time in miliseconds
+ * @return int returns(0) if the number was parsed, returns(-1) if the end of the trace was reached
+ */
+static int DS_TraceParse(DSArrival *arrival, double *value)
+{
+    const char *data = arrival->trace;
+    size_t pos = arrival->trace_pos;
+    size_t size = arrival->trace_size;
+
+    while (pos < size) {
+        // skipping whitespace
+        if (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n') {
+            pos++;
+            continue;
+        }
+
+        // skipping lines which are not numbers (comments, headers)
+        if ((data[pos] < '0' || data[pos] > '9') && data[pos] != '.') {
+            while (pos < size && data[pos] != '\n') {
+                pos++;
+            }
+            continue;
+        }
+
+        // parsing the number
+        double num = 0.0, scale = 1.0;
+        bool fraction = false;
+        for (; pos < size; pos++) {
+            if (data[pos] >= '0' && data[pos] <= '9') {
+                if (fraction) {
+                    scale /= 10.0;
+                    num += (data[pos] - '0') * scale;
+                } else {
+                    num = num * 10.0 + (data[pos] - '0');
+                }
+            } else if (data[pos] == '.' && !fraction) {
+                fraction = true;
+            } else {
+                break;
+            }
+        }
+
+        // skipping the rest of the line
+        while (pos < size && data[pos] != '\n') {
+            pos++;
+        }
+
+        arrival->trace_pos = pos;
+        *value = num;
+        return 0;
+    }
+
+    arrival->trace_pos = pos;
+    return -1;
+}
+
+/**
+ * Maps the trace file into memory. The file is only mapped, not read, so pages are loaded when
+ * the arrivals reach them and even very long traces don't cost any memory at startup.
+ *
+ * @param arrival Pointer to arrival process
+ * @param path Path to the trace file
+ * @return int returns(0) if the trace was mapped, otherwise returns(-1)
+ */
+static int DS_TraceOpen(DSArrival *arrival, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        DS_ERROR("ERROR - DS_ArrivalInit, can't open trace file %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        DS_ERROR("ERROR - DS_ArrivalInit, trace file %s is empty\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        DS_ERROR("ERROR - DS_ArrivalInit, mmap failed (trace)\n");
+        return -1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    arrival->trace = data;
+    arrival->trace_size = st.st_size;
+    arrival->trace_pos = 0;
+
+    // checking that the trace contains at least one arrival
+    double value;
+    if (DS_TraceParse(arrival, &value) != 0) {
+        DS_ERROR("ERROR - DS_ArrivalInit, trace file %s has no arrivals\n", path);
+        DS_ArrivalDestroy(arrival);
+        return -1;
+    }
+    arrival->trace_pos = 0;
+
+    return 0;
+}
+
+/**
+ * Initializes arrival process from specification string. Supported specifications are:
+ *  "uniform"                    - every customer sleeps <0, TZ> ms after it's spawned (default)
+ *  "poisson:RATE"               - poisson process with RATE customers per second
+ *  "mmpp:RATE0,RATE1,S01,S10"   - markov modulated poisson process, S01 and S10 are switching rates per second
+ *  "trace:FILE"                 - inter-arrival times in miliseconds from FILE, one per line, replayed in a loop
+ *
+ * @param arrival Pointer to arrival process
+ * @param spec Specification string
+ * @param seed Seed of the random number generator
+ * @return int returns(0) if the arrival process was initialized, returns(-1) if the specification is wrong
+ */
+int DS_ArrivalInit(DSArrival *arrival, const char *spec, unsigned long seed)
+{
+    memset(arrival, 0, sizeof(DSArrival));
+    DS_RandomSeed(&(arrival->rng), seed);
+
+    // parsing the specification
+    if (spec == NULL || strcmp(spec, "uniform") == 0) {
+        arrival->type = DS_ARRIVAL_UNIFORM;
+
+    } else if (strncmp(spec, "poisson:", 8) == 0) {
+        arrival->type = DS_ARRIVAL_POISSON;
+        if (sscanf(spec + 8, "%lf", &(arrival->rate[0])) != 1 || arrival->rate[0] <= 0) {
+            DS_ERROR("ERROR - DS_ArrivalInit, wrong poisson rate\n");
+            return -1;
+        }
+
+    } else if (strncmp(spec, "mmpp:", 5) == 0) {
+        arrival->type = DS_ARRIVAL_MMPP;
+        if (sscanf(spec + 5, "%lf,%lf,%lf,%lf", &(arrival->rate[0]), &(arrival->rate[1]),
+                   &(arrival->switch_rate[0]), &(arrival->switch_rate[1])) != 4
+            || arrival->rate[0] < 0 || arrival->rate[1] < 0 || arrival->rate[0] + arrival->rate[1] <= 0
+            || arrival->switch_rate[0] <= 0 || arrival->switch_rate[1] <= 0) {
+            DS_ERROR("ERROR - DS_ArrivalInit, wrong mmpp parameters\n");
+            return -1;
+        }
+
+    } else if (strncmp(spec, "trace:", 6) == 0) {
+        arrival->type = DS_ARRIVAL_TRACE;
+        return DS_TraceOpen(arrival, spec + 6);
+
+    } else {
+        DS_ERROR("ERROR - DS_ArrivalInit, unknown arrival process %s\n", spec);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns time to the next arrival. Time is independent of the state of the office (open-loop).
+ *
+ * @param arrival Pointer to arrival process
+ * @return uint64_t Time to the next arrival in nanoseconds, (0) for the uniform process
+ */
+uint64_t DS_ArrivalNext(DSArrival *arrival)
+{
+    double sec = 0.0, msec = 0.0;
+
+    switch (arrival->type) {
+        case DS_ARRIVAL_POISSON:
+            sec = DS_RandomExp(&(arrival->rng), arrival->rate[0]);
+            break;
+
+        case DS_ARRIVAL_MMPP:
+            // race between the next arrival and the next state switch, both are memoryless
+            for (;;) {
+                double rate = arrival->rate[arrival->state];
+                double to_switch = DS_RandomExp(&(arrival->rng), arrival->switch_rate[arrival->state]);
+                double to_arrival = (rate > 0) ? DS_RandomExp(&(arrival->rng), rate) : to_switch + 1.0;
+
+                if (to_arrival <= to_switch) {
+                    sec += to_arrival;
+                    break;
+                }
+                sec += to_switch;
+                arrival->state = !arrival->state;
+            }
+            break;
+
+        case DS_ARRIVAL_TRACE:
+            // replaying the trace from the start when it ends
+            if (DS_TraceParse(arrival, &msec) != 0) {
+                arrival->trace_pos = 0;
+                DS_TraceParse(arrival, &msec);
+            }
+            return (uint64_t)(msec * DS_NSEC_PER_MSEC);
+
+        default:
+            return 0;
+    }
+
+    return (uint64_t)(sec * DS_NSEC_PER_SEC);
+}
+
+/**
+ * Releases the arrival process (unmaps the trace file).
+ *
+ * @param arrival Pointer to arrival process
+ */
+void DS_ArrivalDestroy(DSArrival *arrival)
+{
+    if (arrival->trace != NULL) {
+        munmap((void *)arrival->trace, arrival->trace_size);
+        arrival->trace = NULL;
+    }
+}
+
+
+
+/* - - - - - - - - - - - - - */
+/*   DS_SERVICE FUNCTIONS    */
+/* - - - - - - - - - - - - - */
+// Service time distributions, sampled by officers when they start serving a customer
+
+/**
+ * Inverse CDF of standard normal distribution (rational approximation by P. J. Acklam, relative error 1.15e-9),
+ * closed form in O(1), so lognormal service times are sampled from it directly.
+ *
+ * @param p Probability in interval (0, 1)
+ * @return double Quantile of standard normal distribution
+ */
+static double DS_NormalQuantile(double p)
+{
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double p_low = 0.02425;
+
+    // lower tail
+    if (p < p_low) {
+        double q = sqrt(-2 * log(p));
+        return (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+               ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+    }
+
+    // upper tail
+    if (p > 1 - p_low) {
+        double q = sqrt(-2 * log(1 - p));
+        return -(((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+                ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+    }
+
+    // central region
+    double q = p - 0.5, r = q * q;
+    return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5])*q /
+           (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1);
+}
+
+/**
+ * Loads empirical histogram from a file and builds an alias table (Vose's method). Every line of the file
+ * contains service time in miliseconds and optionaly a weight of the bin ("time [weight]").
+ *
+ * @param service Pointer to service time distribution
+ * @param path Path to the histogram file
+ * @return int returns(0) if the histogram was loaded, otherwise returns(-1)
+ */
+static int DS_HistogramLoad(DSService *service, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        DS_ERROR("ERROR - DS_ServiceInit, can't open histogram file %s\n", path);
+        return -1;
+    }
+
+    // reading the bins, weights are temporarily stored in prob
+    char line[DS_LINE_SIZE];
+    double weight_sum = 0.0;
+    unsigned int n = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        double value, weight = 1.0;
+        int read = sscanf(line, "%lf %lf", &value, &weight);
+        if (read < 1 || value < 0 || weight < 0) {
+            continue;
+        }
+        if (n == DS_HIST_MAX_BINS) {
+            DS_ERROR("ERROR - DS_ServiceInit, histogram has more than %d bins\n", DS_HIST_MAX_BINS);
+            fclose(file);
+            return -1;
+        }
+        service->table.hist.value[n] = value;
+        service->table.hist.prob[n] = weight;
+        weight_sum += weight;
+        n++;
+    }
+    fclose(file);
+
+    if (n == 0 || weight_sum <= 0) {
+        DS_ERROR("ERROR - DS_ServiceInit, histogram file %s is empty\n", path);
+        return -1;
+    }
+
+    // scaling probabilities so the mean bin has probability 1 and computing the mean
+    unsigned int small[DS_HIST_MAX_BINS], large[DS_HIST_MAX_BINS];
+    unsigned int n_small = 0, n_large = 0;
+    service->mean = 0.0;
+    for (unsigned int i = 0; i < n; i++) {
+        service->mean += service->table.hist.value[i] * service->table.hist.prob[i] / weight_sum;
+        service->table.hist.prob[i] = service->table.hist.prob[i] * n / weight_sum;
+        service->table.hist.alias[i] = i;
+        if (service->table.hist.prob[i] < 1.0) {
+            small[n_small++] = i;
+        } else {
+            large[n_large++] = i;
+        }
+    }
+
+    // pairing every small bin with a large bin
+    while (n_small > 0 && n_large > 0) {
+        unsigned int s = small[--n_small];
+        unsigned int l = large[--n_large];
+        service->table.hist.alias[s] = l;
+        service->table.hist.prob[l] -= 1.0 - service->table.hist.prob[s];
+        if (service->table.hist.prob[l] < 1.0) {
+            small[n_small++] = l;
+        } else {
+            large[n_large++] = l;
+        }
+    }
+
+    // remaining bins are full (rounding errors)
+    while (n_large > 0) {
+        service->table.hist.prob[large[--n_large]] = 1.0;
+    }
+    while (n_small > 0) {
+        service->table.hist.prob[small[--n_small]] = 1.0;
+    }
+
+    service->bins = n;
+    return 0;
+}
+
+/**
+ * Initializes service time distribution from specification string, all times are in miliseconds:
+ *  "const:T"               - every service takes T ms
+ *  "uniform:A,B"           - uniform distribution in interval <A, B> (default is uniform:0,10)
+ *  "exp:M"                 - exponential distribution with mean M
+ *  "lognormal:MU,SIGMA"    - lognormal distribution, MU and SIGMA are parameters of the underlying normal distribution
+ *  "hist:FILE"             - empirical histogram, lines of FILE are "time [weight]"
+ *
+ * @param service Pointer to service time distribution
+ * @param spec Specification string
+ * @return int returns(0) if the distribution was initialized, returns(-1) if the specification is wrong
+ */
+int DS_ServiceInit(DSService *service, const char *spec)
+{
+    memset(service, 0, sizeof(DSService));
+
+    if (strncmp(spec, "const:", 6) == 0) {
+        service->type = DS_SERVICE_CONSTANT;
+        if (sscanf(spec + 6, "%lf", &(service->param[0])) != 1 || service->param[0] < 0) {
+            DS_ERROR("ERROR - DS_ServiceInit, wrong constant service time\n");
+            return -1;
+        }
+        service->mean = service->param[0];
+
+    } else if (strncmp(spec, "uniform:", 8) == 0) {
+        service->type = DS_SERVICE_UNIFORM;
+        if (sscanf(spec + 8, "%lf,%lf", &(service->param[0]), &(service->param[1])) != 2
+            || service->param[0] < 0 || service->param[1] < service->param[0]) {
+            DS_ERROR("ERROR - DS_ServiceInit, wrong uniform service time\n");
+            return -1;
+        }
+        service->mean = (service->param[0] + service->param[1]) / 2;
+
+    } else if (strncmp(spec, "exp:", 4) == 0) {
+        service->type = DS_SERVICE_EXP;
+        if (sscanf(spec + 4, "%lf", &(service->param[0])) != 1 || service->param[0] <= 0) {
+            DS_ERROR("ERROR - DS_ServiceInit, wrong exponential service time\n");
+            return -1;
+        }
+        service->mean = service->param[0];
+
+    } else if (strncmp(spec, "lognormal:", 10) == 0) {
+        service->type = DS_SERVICE_LOGNORMAL;
+        if (sscanf(spec + 10, "%lf,%lf", &(service->param[0]), &(service->param[1])) != 2 || service->param[1] < 0) {
+            DS_ERROR("ERROR - DS_ServiceInit, wrong lognormal service time\n");
+            return -1;
+        }
+        service->mean = exp(service->param[0] + service->param[1] * service->param[1] / 2);
+
+    } else if (strncmp(spec, "hist:", 5) == 0) {
+        service->type = DS_SERVICE_EMPIRICAL;
+        return DS_HistogramLoad(service, spec + 5);
+
+    } else {
+        DS_ERROR("ERROR - DS_ServiceInit, unknown service time distribution %s\n", spec);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns random service time, every distribution is sampled in O(1) (closed form or alias table).
+ *
+ * @param service Pointer to service time distribution
+ * @param rng Pointer to the random number generator of the calling process
+ * @return double Service time in miliseconds
+ */
+double DS_ServiceSample(const DSService *service, DSRandom *rng)
+{
+    double u = DS_RandomUniform(rng);
+
+    switch (service->type) {
+        case DS_SERVICE_CONSTANT:
+            return service->param[0];
+
+        case DS_SERVICE_UNIFORM:
+            return service->param[0] + u * (service->param[1] - service->param[0]);
+
+        case DS_SERVICE_EXP:
+            return -service->param[0] * log(1.0 - u);
+
+        case DS_SERVICE_LOGNORMAL:
+            // exact inverse CDF, so the tail isn't truncated, u is moved by half a step of erand48() into (0, 1)
+            return exp(service->param[0] + service->param[1] * DS_NormalQuantile(u + 0x1p-49));
+
+        case DS_SERVICE_EMPIRICAL: {
+            // one uniform number selects the bin and decides between the bin and it's alias
+            double x = u * service->bins;
+            unsigned int i = (unsigned int)x;
+            return ((x - i) < service->table.hist.prob[i]) ? service->table.hist.value[i]
+                                                           : service->table.hist.value[service->table.hist.alias[i]];
+        }
+
+        default:
+            return 0.0;
+    }
+}
@@ -0,0 +1,167 @@
+/** @file distribution.h
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// standart libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+
+/* - - - - - - - - - - - -*/
+/*    TYPE DEFINITIONS    */
+/* - - - - - - - - - - - -*/
+
+/* Constant macros */
+#define DS_NSEC_PER_MSEC 1000000ULL     // nanoseconds in one milisecond
+#define DS_NSEC_PER_SEC 1000000000ULL   // nanoseconds in one second
+#define DS_HIST_MAX_BINS 1024           // max number of bins in empirical histogram
+#define DS_LINE_SIZE 200                // max length of a line in histogram file
+
+/* Error messages of all modules, they aren't printed when the process is quiet (programs using libptable) */
+#define DS_ERROR(...) do { if (!DS_Quiet) { fprintf(stderr, __VA_ARGS__); } } while (0)
+
+
+
+/* - - - - - - - - - - - */
+/*         ENUMS         */
+/* - - - - - - - - - - - */
+
+/* Types of customer arrival processes */
+typedef enum {
+    // every customer is spawned at start and sleeps <0, TZ> miliseconds (assignment behaviour)
+    DS_ARRIVAL_UNIFORM = 0,
+    // exponential inter-arrival times with a fixed rate
+    DS_ARRIVAL_POISSON = 1,
+    // two state markov modulated poisson process (bursty traffic)
+    DS_ARRIVAL_MMPP = 2,
+    // inter-arrival times replayed from a file
+    DS_ARRIVAL_TRACE = 3,
+} DSArrivalType;
+
+/* Types of service time distributions */
+typedef enum {
+    // every service takes the same time
+    DS_SERVICE_CONSTANT = 0,
+    // uniform distribution in interval <min, max>
+    DS_SERVICE_UNIFORM = 1,
+    // exponential distribution with given mean
+    DS_SERVICE_EXP = 2,
+    // lognormal distribution (heavy tail), sampled from inverse CDF of the normal distribution
+    DS_SERVICE_LOGNORMAL = 3,
+    // empirical histogram loaded from a file, sampled from alias table
+    DS_SERVICE_EMPIRICAL = 4,
+} DSServiceType;
+
+/* Independent random streams derived from one seed, every process of a kind takes it's own stream by it's number */
+typedef enum {
+    // service chosen by a customer
+    DS_STREAM_CUSTOMER = 1,
+    // service times and breaks of an officer
+    DS_STREAM_OFFICER = 2,
+} DSStream;
+
+
+
+/* - - - - - - - - - - - - */
+/*     DISTRIBUTION DATA   */
+/* - - - - - - - - - - - - */
+
+/* State of a random number generator, every process has it's own copy after fork() */
+typedef struct DSRandom {
+    unsigned short xsubi[3];
+} DSRandom;
+
+/* Arrival process, generates inter-arrival times of customers */
+typedef struct DSArrival {
+    // type of the arrival process
+    DSArrivalType type;
+    // random number generator of the arrival process
+    DSRandom rng;
+    // poisson rate / mmpp rates of both states (customers per second)
+    double rate[2];
+    // mmpp switching rates from state 0 to 1 and from 1 to 0 (per second)
+    double switch_rate[2];
+    // current state of the mmpp
+    int state;
+    // memory mapped trace file (inter-arrival times in miliseconds, one per line)
+    const char *trace;
+    size_t trace_size;
+    size_t trace_pos;
+} DSArrival;
+
+/* Service time distribution, the alias table is precomputed so every sample costs O(1) */
+typedef struct DSService {
+    // type of the distribution
+    DSServiceType type;
+    // parameters of the distribution (constant: time, uniform: min, max, exp: mean, lognormal: mu, sigma)
+    double param[2];
+    // expected service time in miliseconds
+    double mean;
+    // number of bins in the empirical histogram
+    unsigned int bins;
+    union {
+        // empirical - alias table (walker/vose)
+        struct {
+            double value[DS_HIST_MAX_BINS];
+            double prob[DS_HIST_MAX_BINS];
+            unsigned int alias[DS_HIST_MAX_BINS];
+        } hist;
+    } table;
+} DSService;
+
+
+
+/* - - - - - - - - - - - - - - */
+/*     DS_RANDOM FUNCTIONS     */
+/* - - - - - - - - - - - - - - */
+
+/* Error messages aren't printed if it's set (process local) */
+extern bool DS_Quiet;
+
+/* Seeds the random number generator */
+void DS_RandomSeed(DSRandom *rng, unsigned long seed);
+
+/* Seeds the random number generator of stream <id> of given kind, streams of one seed are uncorrelated */
+void DS_RandomSeedStream(DSRandom *rng, unsigned long seed, DSStream kind, unsigned int id);
+
+/* Returns random number in interval <0, 1) */
+double DS_RandomUniform(DSRandom *rng);
+
+/* Returns exponentialy distributed random number with given rate */
+double DS_RandomExp(DSRandom *rng, double rate);
+
+
+/* - - - - - - - - - - - - - - - */
+/*     DS_ARRIVAL FUNCTIONS      */
+/* - - - - - - - - - - - - - - - */
+
+/* Initializes arrival process from specification string (uniform, poisson:R, mmpp:R0,R1,S01,S10, trace:FILE) */
+int DS_ArrivalInit(DSArrival *arrival, const char *spec, unsigned long seed);
+
+/* Returns time to the next arrival in nanoseconds */
+uint64_t DS_ArrivalNext(DSArrival *arrival);
+
+/* Releases the arrival process */
+void DS_ArrivalDestroy(DSArrival *arrival);
+
+
+/* - - - - - - - - - - - - - - - */
+/*     DS_SERVICE FUNCTIONS      */
+/* - - - - - - - - - - - - - - - */
+
+/* Initializes service time distribution from specification string (const:T, uniform:A,B, exp:M, lognormal:MU,SIGMA, hist:FILE) */
+int DS_ServiceInit(DSService *service, const char *spec);
+
+/* Returns random service time in miliseconds */
+double DS_ServiceSample(const DSService *service, DSRandom *rng);
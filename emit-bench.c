@@ -0,0 +1,180 @@
+/**
+ * @file emit-bench.c
+ * @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ * @brief Compares the emission of log lines from templates (EV_LinePrepare() + EV_LineNumber(), SM_CounterEvent())
+ *        with formatting them by sprintf() and SM_CounterPrint(). Lines of both paths are checked to be the same,
+ *        time per event is printed.
+ * @date 2023-04-24
+ */
+
+/* - - - - - - - - - - -*/
+/*      DEFINITIONS     */
+/* - - - - - - - - - - -*/
+
+/* libraries */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "process_table.h"
+
+/* constants */
+#define PROGRAM_NAME "emit-bench.c"
+#define BENCH_EVENTS 1000000    // default number of events
+
+
+
+/* - - - - - - - - - - -*/
+/*       BENCHMARKS     */
+/* - - - - - - - - - - -*/
+
+/* events of the benchmark, every one of them in turn (closing is printed once per run, so it's left out) */
+static const EVEvent bench_events[] = {
+    EV_Z_START, EV_Z_ENTER, EV_U_SERVING, EV_Z_CALLED, EV_U_SERVED, EV_Z_HOME, EV_U_BREAK, EV_U_BREAK_END,
+};
+#define BENCH_EVENT_NUM (sizeof(bench_events) / sizeof(bench_events[0]))
+
+/**
+ * Lines of templates are the same as lines formatted by printf, for all events and numbers of every length.
+ *
+ * @return int (0) if all lines are the same, (-1) if not.
+ */
+static int bench_verify(void)
+{
+    static const int values[] = {0, 1, 9, 10, 99, 100, 12345, 999999, 1000000, INT32_MAX, -1, INT32_MIN};
+    static const uint32_t seqs[] = {1, 9, 10, 4294967295u};
+    char message[EV_MESSAGE_SIZE];
+    char expected[EV_SEQ_SIZE + EV_MESSAGE_SIZE + 1];
+
+    for (int event = 0; event < EV_NUM; event++) {
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            for (size_t j = 0; j < sizeof(seqs) / sizeof(seqs[0]); j++) {
+                int id = values[i], arg = values[(i + j) % (sizeof(values) / sizeof(values[0]))];
+                EV_Message(message, sizeof(message), event, id, arg);
+                int length = snprintf(expected, sizeof(expected), "%u: %s\n", seqs[j], message);
+
+                EVLine line;
+                EV_LinePrepare(&line, event, id, arg);
+                EV_LineNumber(&line, seqs[j]);
+                if ((int)(line.end - line.start) != length || memcmp(line.data + line.start, expected, length) != 0) {
+                    fprintf(stderr, "[%s] - Line of event %d differs: %s", PROGRAM_NAME, event, expected);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Formatting of lines into memory, by sprintf() or from templates.
+ *
+ * @return double Nanoseconds per event.
+ */
+static double bench_format(int events, bool templates)
+{
+    char message[EV_MESSAGE_SIZE];
+    char buffer[EV_SEQ_SIZE + EV_MESSAGE_SIZE + 1];
+    EVLine line;
+    unsigned long checksum = 0;
+
+    uint64_t start = nsec_now();
+    for (int i = 0; i < events; i++) {
+        EVEvent event = bench_events[i % BENCH_EVENT_NUM];
+        if (templates) {
+            EV_LinePrepare(&line, event, i, 1 + i % SERVICE_NUM);
+            EV_LineNumber(&line, (uint32_t)i + 1);
+            checksum += line.end - line.start;
+        } else {
+            EV_Message(message, sizeof(message), event, i, 1 + i % SERVICE_NUM);
+            checksum += snprintf(buffer, sizeof(buffer), "%d: %s\n", i + 1, message);
+        }
+    }
+    uint64_t elapsed = nsec_now() - start;
+
+    // checksum keeps the compiler from dropping the loop
+    return (checksum == 0) ? -1.0 : (double)elapsed / events;
+}
+
+/**
+ * Whole emission of events into the log (/dev/null) - semaphore, counter, line and write.
+ *
+ * @return double Nanoseconds per event, negative on error.
+ */
+static double bench_emit(int events, bool templates)
+{
+    char *keys[] = {"Z", "U"};
+    const size_t sizes[] = {1, 1};
+    PTList *list = PT_InitCapacity(2, keys, sizes);
+    FILE *file = fopen("/dev/null", "w");
+    if (list == NULL || file == NULL || SM_CounterInit(list->shared_data) != 0) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        PT_Destroy(&list);
+        return -1.0;
+    }
+
+    char message[EV_MESSAGE_SIZE];
+    int err_check = 0;
+    uint64_t start = nsec_now();
+    for (int i = 0; i < events; i++) {
+        EVEvent event = bench_events[i % BENCH_EVENT_NUM];
+        if (templates) {
+            err_check += SM_CounterEvent(list->shared_data, file, event, i, 1 + i % SERVICE_NUM);
+        } else {
+            EV_Message(message, sizeof(message), event, i, 1 + i % SERVICE_NUM);
+            err_check += SM_CounterPrint(list->shared_data, file, message);
+        }
+    }
+    uint64_t elapsed = nsec_now() - start;
+
+    SM_CounterDestroy(list->shared_data);
+    PT_Destroy(&list);
+    fclose(file);
+    return (err_check != 0) ? -1.0 : (double)elapsed / events;
+}
+
+
+
+/* - - - - - - - - - - -*/
+/*         MAIN         */
+/* - - - - - - - - - - -*/
+
+/* usage: emit-bench [EVENTS] */
+int main(int argc, char *argv[])
+{
+    // [0] - parse arguments
+    int events = (argc >= 2) ? atoi(argv[1]) : BENCH_EVENTS;
+    if (argc > 2 || events <= 0) {
+        fprintf(stderr, "[%s] - Wrong arguments, usage: %s [EVENTS]\n", PROGRAM_NAME, argv[0]);
+        return 1;
+    }
+
+    // [1] - both paths print the same lines
+    if (bench_verify() != 0) {
+        return 1;
+    }
+
+    // [2] - formatting alone and the whole emission
+    struct {
+        const char *name;
+        double printf_ns;
+        double template_ns;
+    } rows[] = {
+        {"format", bench_format(events, false), bench_format(events, true)},
+        {"emit", bench_emit(events, false), bench_emit(events, true)},
+    };
+
+    printf("log lines, %d events\n", events);
+    printf("%-10s %12s %12s %8s\n", "path", "printf ns", "template ns", "speedup");
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        if (rows[i].printf_ns < 0 || rows[i].template_ns < 0) {
+            fprintf(stderr, "[%s] - Benchmark %s failed\n", PROGRAM_NAME, rows[i].name);
+            return 1;
+        }
+        printf("%-10s %12.1f %12.1f %7.2fx\n", rows[i].name, rows[i].printf_ns, rows[i].template_ns,
+               rows[i].printf_ns / rows[i].template_ns);
+    }
+
+    return 0;
+}
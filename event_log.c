@@ -0,0 +1,231 @@
+/** @file event_log.c
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+
+#include "event_log.h"
+
+
+
+/* - - - - - - - - - - - - - - */
+/*      EV_LOG FUNCTIONS       */
+/* - - - - - - - - - - - - - - */
+// Events of the log - the office writes them as text lines or binary records, proj2-render turns records into lines
+
+/* Template of an event - role, message and it's length, messages with an argument end with it */
+#define EV_TEMPLATE(role, message, has_arg) {role, message, sizeof(message) - 1, has_arg}
+
+/* Template of every event */
+static const struct {
+    uint8_t role;
+    const char *message;
+    unsigned int length;
+    int has_arg;
+} EV_Events[EV_NUM] = {
+    [EV_Z_START] = EV_TEMPLATE('Z', "started", 0),
+    [EV_Z_ENTER] = EV_TEMPLATE('Z', "entering office for a service", 1),
+    [EV_Z_REJECTED] = EV_TEMPLATE('Z', "rejected from a service", 1),
+    [EV_Z_CALLED] = EV_TEMPLATE('Z', "called by office worker", 0),
+    [EV_Z_RENEGED] = EV_TEMPLATE('Z', "leaving the queue of a service", 1),
+    [EV_Z_HOME] = EV_TEMPLATE('Z', "going home", 0),
+    [EV_U_START] = EV_TEMPLATE('U', "started", 0),
+    [EV_U_SERVING] = EV_TEMPLATE('U', "serving a service of type", 1),
+    [EV_U_SERVED] = EV_TEMPLATE('U', "service finished", 0),
+    [EV_U_BREAK] = EV_TEMPLATE('U', "taking break", 0),
+    [EV_U_BREAK_END] = EV_TEMPLATE('U', "break finished", 0),
+    [EV_U_HOME] = EV_TEMPLATE('U', "going home", 0),
+    [EV_CLOSING] = EV_TEMPLATE(0, "closing", 0),
+};
+
+/* Pairs of decimal digits "00" - "99" */
+static const char EV_Digits[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354"
+    "555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+/**
+ * Writes decimal digits of the value backwards, two digits at a time.
+ *
+ * @param end End of the digits.
+ * @param value Value.
+ * @return char* First digit.
+ */
+static char *EV_UtoaBack(char *end, uint32_t value)
+{
+    while (value >= 100) {
+        unsigned int pair = (value % 100) * 2;
+        value /= 100;
+        *--end = EV_Digits[pair + 1];
+        *--end = EV_Digits[pair];
+    }
+    if (value >= 10) {
+        *--end = EV_Digits[value * 2 + 1];
+        *--end = EV_Digits[value * 2];
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+/**
+ * Writes decimal digits of the value, like "%u" without the terminating zero.
+ *
+ * @param buffer (out) Buffer for at least 10 digits.
+ * @param value Value.
+ * @return char* End of the digits.
+ */
+char *EV_Utoa(char *buffer, uint32_t value)
+{
+    char digits[10];
+    char *start = EV_UtoaBack(digits + sizeof(digits), value);
+    size_t length = digits + sizeof(digits) - start;
+    memcpy(buffer, start, length);
+    return buffer + length;
+}
+
+/**
+ * Writes decimal digits of a signed value, like "%d" without the terminating zero.
+ *
+ * @param buffer (out) Buffer for at least 11 characters.
+ * @param value Value.
+ * @return char* End of the digits.
+ */
+static char *EV_Itoa(char *buffer, int value)
+{
+    if (value < 0) {
+        *buffer++ = '-';
+        return EV_Utoa(buffer, 0u - (uint32_t)value);
+    }
+    return EV_Utoa(buffer, (uint32_t)value);
+}
+
+/**
+ * Returns the format of the log of the given name.
+ *
+ * @param name Name of the format ("text", "binary").
+ * @return int EVFormat, (-1) if the name is unknown.
+ */
+int EV_FormatParse(const char *name)
+{
+    if (strcmp(name, "text") == 0) {
+        return EV_FORMAT_TEXT;
+    }
+    if (strcmp(name, "binary") == 0) {
+        return EV_FORMAT_BINARY;
+    }
+    return -1;
+}
+
+/**
+ * Fills the record of an event, the sequence number is left for the writer which holds the counter.
+ *
+ * @param record (out) Record of the event.
+ * @param event Event.
+ * @param id Number of the customer or officer.
+ * @param arg Argument of the event (type of the service), (0) if it has none.
+ */
+void EV_RecordFill(EVRecord *record, EVEvent event, int id, int arg)
+{
+    record->seq = 0;
+    record->event = (uint16_t)event;
+    record->role = ((unsigned int)event < EV_NUM) ? EV_Events[event].role : 0;
+    record->pad = 0;
+    record->id = (uint32_t)id;
+    record->arg = (uint32_t)arg;
+}
+
+/**
+ * Writes the message of an event into the buffer, in the same format as the assignment.
+ *
+ * @param buffer (out) Buffer for the message.
+ * @param size Size of the buffer.
+ * @param event Event.
+ * @param id Number of the customer or officer.
+ * @param arg Argument of the event (type of the service).
+ * @return int Length of the message, (-1) if the event is unknown.
+ */
+int EV_Message(char *buffer, size_t size, EVEvent event, int id, int arg)
+{
+    if ((unsigned int)event >= EV_NUM) {
+        return -1;
+    }
+    if (EV_Events[event].role == 0) {
+        return snprintf(buffer, size, "%s", EV_Events[event].message);
+    }
+    if (EV_Events[event].has_arg) {
+        return snprintf(buffer, size, "%c %d: %s %d", EV_Events[event].role, id, EV_Events[event].message, arg);
+    }
+    return snprintf(buffer, size, "%c %d: %s", EV_Events[event].role, id, EV_Events[event].message);
+}
+
+/**
+ * Writes the message of an event and the end of the line into the line from it's template, in the same format
+ * as EV_Message(), without any format string. The number of the line is added by EV_LineNumber().
+ *
+ * @param line (out) Line of the event.
+ * @param event Event.
+ * @param id Number of the customer or officer.
+ * @param arg Argument of the event (type of the service).
+ * @return int Length of the message, (-1) if the event is unknown.
+ */
+int EV_LinePrepare(EVLine *line, EVEvent event, int id, int arg)
+{
+    if ((unsigned int)event >= EV_NUM) {
+        return -1;
+    }
+
+    // "R id: message arg\n", 11 characters of a number at most
+    char *pos = line->data + EV_SEQ_SIZE;
+    if (EV_Events[event].role != 0) {
+        *pos++ = (char)EV_Events[event].role;
+        *pos++ = ' ';
+        pos = EV_Itoa(pos, id);
+        *pos++ = ':';
+        *pos++ = ' ';
+    }
+    memcpy(pos, EV_Events[event].message, EV_Events[event].length);
+    pos += EV_Events[event].length;
+    if (EV_Events[event].has_arg) {
+        *pos++ = ' ';
+        pos = EV_Itoa(pos, arg);
+    }
+    *pos++ = '\n';
+
+    line->start = EV_SEQ_SIZE;
+    line->end = (unsigned int)(pos - line->data);
+    return (int)(line->end - EV_SEQ_SIZE - 1);
+}
+
+/**
+ * Writes the number of the line and ": " in front of the message written by EV_LinePrepare().
+ *
+ * @param line Line of the event.
+ * @param seq Number of the line.
+ */
+void EV_LineNumber(EVLine *line, uint32_t seq)
+{
+    char *start = line->data + EV_SEQ_SIZE;
+    *--start = ' ';
+    *--start = ':';
+    line->start = (unsigned int)(EV_UtoaBack(start, seq) - line->data);
+}
+
+/**
+ * Prints the record as a line of the text log ("seq: message").
+ *
+ * @param file Pointer to file where the line will be printed.
+ * @param record Record of the binary log.
+ * @return int return(0) if the line was printed, (-1) if the record is wrong.
+ */
+int EV_Render(FILE *file, const EVRecord *record)
+{
+    EVLine line;
+    if (record->event >= EV_NUM || record->role != EV_Events[record->event].role) {
+        return -1;
+    }
+    if (EV_LinePrepare(&line, record->event, (int)record->id, (int)record->arg) < 0) {
+        return -1;
+    }
+    EV_LineNumber(&line, record->seq);
+    fwrite(line.data + line.start, 1, line.end - line.start, file);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/** @file event_log.h
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// standart libraries
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+
+
+/* - - - - - - - - - - - -*/
+/*    TYPE DEFINITIONS    */
+/* - - - - - - - - - - - -*/
+
+/* Constant macros */
+#define EV_MESSAGE_SIZE 64      // max length of a message of an event, with the terminating zero
+#define EV_SEQ_SIZE 12          // room for the number of the line and ": " in front of the message (EVLine)
+#define EV_EXPORT_MAGIC "P2TLINE"   // magic of the timeline export (8 bytes with the terminating zero)
+#define EV_EXPORT_VERSION 1         // version of the timeline export
+#define EV_EXPORT_ALIGN 64          // every column of the timeline export starts at a multiple of it
+#define EV_EXPORT_NAME_SIZE 24      // size of the name of a column of the timeline export
+#define EV_TIME_NONE UINT64_MAX     // time of a step which didn't happen (customer turned away doesn't get called)
+
+
+
+/* - - - - - - - - - - - */
+/*         ENUMS         */
+/* - - - - - - - - - - - */
+
+/* Events printed into the log, arg is the type of the service (0 if the event has none) */
+typedef enum {
+    EV_Z_START = 0,         // "Z id: started"
+    EV_Z_ENTER = 1,         // "Z id: entering office for a service arg"
+    EV_Z_REJECTED = 2,      // "Z id: rejected from a service arg"
+    EV_Z_CALLED = 3,        // "Z id: called by office worker"
+    EV_Z_RENEGED = 4,       // "Z id: leaving the queue of a service arg"
+    EV_Z_HOME = 5,          // "Z id: going home"
+    EV_U_START = 6,         // "U id: started"
+    EV_U_SERVING = 7,       // "U id: serving a service of type arg"
+    EV_U_SERVED = 8,        // "U id: service finished"
+    EV_U_BREAK = 9,         // "U id: taking break"
+    EV_U_BREAK_END = 10,    // "U id: break finished"
+    EV_U_HOME = 11,         // "U id: going home"
+    EV_CLOSING = 12,        // "closing"
+    EV_NUM = 13,
+} EVEvent;
+
+/* How the visit of a customer ended */
+typedef enum {
+    EV_OUTCOME_SERVED = 0,
+    EV_OUTCOME_REJECTED = 1,    // queue of the service was full
+    EV_OUTCOME_RENEGED = 2,     // customer left the queue before he was called
+    EV_OUTCOME_CLOSED = 3,      // office was closed when the customer came
+} EVOutcome;
+
+/* Kinds of intervals of officers */
+typedef enum {
+    EV_INTERVAL_SERVING = 0,    // serving -> service finished
+    EV_INTERVAL_BREAK = 1,      // taking break -> break finished
+} EVInterval;
+
+/* Tables of the timeline export */
+typedef enum {
+    EV_TABLE_CUSTOMERS = 0,     // one row per customer
+    EV_TABLE_INTERVALS = 1,     // one row per interval of an officer
+    EV_TABLE_NUM = 2,
+} EVTable;
+
+/* Formats of the log */
+typedef enum {
+    // lines "counter: message" (assignment format)
+    EV_FORMAT_TEXT = 0,
+    // fixed size records EVRecord, expanded to the text by proj2-render
+    EV_FORMAT_BINARY = 1,
+} EVFormat;
+
+
+
+/* - - - - - - - - - - - - */
+/*       EVENT RECORD      */
+/* - - - - - - - - - - - - */
+
+/* Record of the binary log (16 bytes, byte order of the machine which wrote it) */
+typedef struct EVRecord {
+    // number of the line in the text log
+    uint32_t seq;
+    // EVEvent
+    uint16_t event;
+    // 'Z', 'U' or 0 (closing)
+    uint8_t role;
+    uint8_t pad;
+    // number of the customer or officer and the argument of the event
+    uint32_t id;
+    uint32_t arg;
+} EVRecord;
+
+/* record is written as it is, so it can't have any padding */
+typedef char EV_RecordSizeCheck[(sizeof(EVRecord) == 16) ? 1 : -1];
+
+/* Line of the text log built from the template of the event, the message is written at EV_SEQ_SIZE before the
+ * number of the line is known, the number is written right in front of it, so the line is never copied */
+typedef struct EVLine {
+    char data[EV_SEQ_SIZE + EV_MESSAGE_SIZE];
+    // line is data[start, end), it ends with '\n' and it isn't zero terminated
+    unsigned int start;
+    unsigned int end;
+} EVLine;
+
+
+
+/* - - - - - - - - - - - - */
+/*     TIMELINE EXPORT     */
+/* - - - - - - - - - - - - */
+
+/* Header of the timeline export, it's followed by column_num column descriptors. Columns are plain arrays
+ * (rows[table] values, width bytes each) at their offsets, so the file can be memory mapped and used directly.
+ * Times are nanoseconds since the start of the office. */
+typedef struct EVExportHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t column_num;
+    // number of rows of every table (EVTable)
+    uint64_t rows[EV_TABLE_NUM];
+    // rows which didn't fit into the shared memory
+    uint64_t dropped;
+    // start of the office (CLOCK_MONOTONIC nanoseconds)
+    uint64_t t_start;
+} EVExportHeader;
+
+/* Column of the timeline export */
+typedef struct EVExportColumn {
+    // name of the column, zero terminated
+    char name[EV_EXPORT_NAME_SIZE];
+    // table of the column (EVTable) and size of one value in bytes (integers in byte order of the machine)
+    uint32_t table;
+    uint32_t width;
+    // offset of the first value from the start of the file
+    uint64_t offset;
+} EVExportColumn;
+
+
+
+/* - - - - - - - - - - - - - */
+/*      EV_LOG FUNCTIONS     */
+/* - - - - - - - - - - - - - */
+
+/* Returns the format of the given name ("text", "binary"), (-1) if the name is unknown */
+int EV_FormatParse(const char *name);
+
+/* Fills the record of an event, sequence number is set by the writer */
+void EV_RecordFill(EVRecord *record, EVEvent event, int id, int arg);
+
+/* Writes message of an event into the buffer, returns it's length or (-1) if the event is unknown */
+int EV_Message(char *buffer, size_t size, EVEvent event, int id, int arg);
+
+/* Writes decimal digits of the value, returns the end of them (not zero terminated) */
+char *EV_Utoa(char *buffer, uint32_t value);
+
+/* Writes message of an event and '\n' into the line, returns (-1) if the event is unknown */
+int EV_LinePrepare(EVLine *line, EVEvent event, int id, int arg);
+
+/* Writes "seq: " in front of the message of the line */
+void EV_LineNumber(EVLine *line, uint32_t seq);
+
+/* Prints the record as a line of the text log, returns (-1) if the record is wrong */
+int EV_Render(FILE *file, const EVRecord *record);
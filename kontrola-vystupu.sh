@@ -15,6 +15,12 @@ Z_called_n=0
 Z_home="^[0-9][0-9]*: Z [0-9][0-9]*: going home$"
 Z_home_n=0
 
+Z_rejected="^[0-9][0-9]*: Z [0-9][0-9]*: rejected from a service [1-3]$"
+Z_rejected_n=0
+
+Z_reneged="^[0-9][0-9]*: Z [0-9][0-9]*: leaving the queue of a service [1-3]$"
+Z_reneged_n=0
+
 U_start="^[0-9][0-9]*: U [0-9][0-9]*: started$"
 U_start_n=0
 
@@ -46,6 +52,10 @@ do
   	Z_called_n=1
   elif echo $line | grep "$Z_home" >/dev/null; then
   	Z_home_n=1
+  elif echo $line | grep "$Z_rejected" >/dev/null; then
+  	Z_rejected_n=1
+  elif echo $line | grep "$Z_reneged" >/dev/null; then
+  	Z_reneged_n=1
   elif echo $line | grep "$U_start" >/dev/null; then
   	U_start_n=1
   elif echo $line | grep "$U_home" >/dev/null; then
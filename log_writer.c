@@ -0,0 +1,440 @@
+/** @file log_writer.c
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+
+#include "log_writer.h"
+
+// linux libs
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+
+
+/* - - - - - - - - - - - - - - */
+/*      LW_RING FUNCTIONS      */
+/* - - - - - - - - - - - - - - */
+// Ring of log bytes in shared memory, filled by all processes and emptied by the writer thread
+
+/**
+ * Returns number of bytes of shared memory needed by a ring.
+ *
+ * @param size Size of data of the ring (power of 2).
+ * @return size_t Size of the ring with it's header.
+ */
+size_t LW_RingBytes(size_t size)
+{
+    return sizeof(LWRing) + size;
+}
+
+/**
+ * Initializes an empty ring, the memory has to be shared and LW_RingBytes(size) long.
+ *
+ * @param ring Pointer to the ring.
+ * @param size Size of data of the ring (power of 2).
+ * @return int returns(0) if the ring is initialized, returns(-1) if the size is wrong or sem_init failed.
+ */
+int LW_RingInit(LWRing *ring, size_t size)
+{
+    if (size == 0 || (size & (size - 1)) != 0) {
+        return -1;
+    }
+    ring->head = 0;
+    ring->tail = 0;
+    ring->sleeping = 0;
+    ring->done = 0;
+    ring->size = size;
+    return (sem_init(&(ring->ready), 1, 0) == 0) ? 0 : -1;
+}
+
+/**
+ * Appends bytes at the head of the ring. When the ring is full the caller waits for the writer, which happens only
+ * if the storage is slower than the office for a long time.
+ *
+ * @param ring Pointer to the ring.
+ * @param data Appended bytes.
+ * @param len Number of appended bytes, at most size of the ring.
+ */
+void LW_RingAppend(LWRing *ring, const void *data, size_t len)
+{
+    uint64_t head = ring->head;
+    while (head + len - __atomic_load_n(&(ring->tail), __ATOMIC_ACQUIRE) > ring->size) {
+        LW_RingWake(ring);
+        sched_yield();
+    }
+
+    // the bytes can wrap around the end of the ring
+    size_t pos = head & (ring->size - 1);
+    size_t first = (len < ring->size - pos) ? len : ring->size - pos;
+    memcpy(ring->data + pos, data, first);
+    memcpy(ring->data, (const char *)data + first, len - first);
+    __atomic_store_n(&(ring->head), head + len, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Wakes the writer up, if it's sleeping. Writer announces it's going to sleep before it checks the ring for
+ * the last time, so either it sees the new bytes or this function sees it's sleeping.
+ *
+ * @param ring Pointer to the ring.
+ */
+void LW_RingWake(LWRing *ring)
+{
+    if (__atomic_exchange_n(&(ring->sleeping), 0, __ATOMIC_SEQ_CST) == 1) {
+        sem_post(&(ring->ready));
+    }
+}
+
+/**
+ * Destroys semaphore of the ring.
+ *
+ * @param ring Pointer to the ring.
+ * @return int returns(0) if the semaphore is destroyed, returns(-1) if not.
+ */
+int LW_RingDestroy(LWRing *ring)
+{
+    return (sem_destroy(&(ring->ready)) == 0) ? 0 : -1;
+}
+
+
+
+/* - - - - - - - - - - - - - - */
+/*     LW_WRITER FUNCTIONS     */
+/* - - - - - - - - - - - - - - */
+// Writer thread of the init process - writes the ring into the log file through io_uring (pwrite() if it's missing)
+
+/**
+ * Writes bytes of the ring into the file synchronously (pwrite backend, short or failed io_uring writes).
+ *
+ * @param writer Pointer to the writer.
+ * @param pos Absolute position of the first byte in the ring.
+ * @param len Number of bytes, they don't wrap around the end of the ring.
+ */
+static void LW_WriteAll(LWWriter *writer, uint64_t pos, size_t len)
+{
+    const char *data = writer->ring->data + (pos & (writer->ring->size - 1));
+    while (len > 0) {
+        ssize_t ret = pwrite(writer->fd, data, len, writer->base + (off_t)pos);
+        writer->submits++;
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            writer->error = (writer->error == 0) ? ((ret == -1) ? errno : EIO) : writer->error;
+            return;
+        }
+        data += ret;
+        pos += ret;
+        len -= ret;
+    }
+}
+
+/**
+ * Sets up io_uring with depth entries and maps it's queues, the ring is registered as a fixed buffer if possible.
+ *
+ * @param writer Pointer to the writer.
+ * @return int returns(0) if io_uring is ready, returns(-1) if it isn't available.
+ */
+static int LW_UringInit(LWWriter *writer)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    writer->uring_fd = (int)syscall(__NR_io_uring_setup, writer->depth, &params);
+    if (writer->uring_fd == -1) {
+        return -1;
+    }
+
+    // [0] - submission and completion queues share one mapping on newer kernels
+    writer->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    writer->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        writer->sq_size = writer->cq_size = (writer->sq_size > writer->cq_size) ? writer->sq_size : writer->cq_size;
+    }
+    writer->sq_ptr = mmap(NULL, writer->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, writer->uring_fd,
+                          IORING_OFF_SQ_RING);
+    writer->cq_ptr = single ? writer->sq_ptr : mmap(NULL, writer->cq_size, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, writer->uring_fd, IORING_OFF_CQ_RING);
+    writer->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    writer->sqes = mmap(NULL, writer->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, writer->uring_fd,
+                        IORING_OFF_SQES);
+    if (writer->sq_ptr == MAP_FAILED || writer->cq_ptr == MAP_FAILED || writer->sqes == MAP_FAILED) {
+        close(writer->uring_fd);
+        return -1;
+    }
+
+    char *sq = writer->sq_ptr, *cq = writer->cq_ptr;
+    writer->sq_head = (unsigned int *)(sq + params.sq_off.head);
+    writer->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    writer->sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    writer->sq_array = (unsigned int *)(sq + params.sq_off.array);
+    writer->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    writer->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    writer->cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    writer->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    // [1] - fixed buffer saves mapping of the pages on every write, it can fail on the limit of locked memory
+    struct iovec iov = {writer->ring->data, writer->ring->size};
+    writer->fixed = (syscall(__NR_io_uring_register, writer->uring_fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0);
+    writer->uring = true;
+    return 0;
+}
+
+/**
+ * Unmaps queues of io_uring and closes it.
+ *
+ * @param writer Pointer to the writer.
+ */
+static void LW_UringDestroy(LWWriter *writer)
+{
+    munmap(writer->sqes, writer->sqes_size);
+    if (writer->cq_ptr != writer->sq_ptr) {
+        munmap(writer->cq_ptr, writer->cq_size);
+    }
+    munmap(writer->sq_ptr, writer->sq_size);
+    close(writer->uring_fd);
+    writer->uring = false;
+}
+
+/**
+ * Takes all completions from the completion queue and marks their writes as done.
+ *
+ * @param writer Pointer to the writer.
+ * @param w_pos Positions of the writes by slots.
+ * @param w_len Lengths of the writes by slots.
+ * @param w_done (out) Finished writes by slots.
+ * @param finish Short or failed writes are finished synchronously.
+ * @return int Number of taken completions.
+ */
+static int LW_UringReap(LWWriter *writer, const uint64_t *w_pos, const size_t *w_len, bool *w_done, bool finish)
+{
+    int reaped = 0;
+    unsigned int c_head = *(writer->cq_head);
+    while (c_head != __atomic_load_n(writer->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &(writer->cqes[c_head & *(writer->cq_mask)]);
+        int slot = (int)cqe->user_data;
+        size_t done = (cqe->res > 0) ? (size_t)cqe->res : 0;
+        if (finish && done < w_len[slot]) {
+            LW_WriteAll(writer, w_pos[slot] + done, w_len[slot] - done);
+        }
+        w_done[slot] = true;
+        reaped++;
+        c_head++;
+    }
+    __atomic_store_n(writer->cq_head, c_head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+/**
+ * Queues one write of the ring, it's submitted by the next io_uring_enter().
+ *
+ * @param writer Pointer to the writer.
+ * @param slot Slot of the write, returned in the completion.
+ * @param pos Absolute position of the first byte in the ring.
+ * @param len Number of bytes, they don't wrap around the end of the ring.
+ */
+static void LW_UringQueue(LWWriter *writer, int slot, uint64_t pos, size_t len)
+{
+    unsigned int tail = *(writer->sq_tail), index = tail & *(writer->sq_mask);
+    struct io_uring_sqe *sqe = &(writer->sqes[index]);
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = writer->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = writer->fd;
+    sqe->off = writer->base + pos;
+    sqe->addr = (uint64_t)(uintptr_t)(writer->ring->data + (pos & (writer->ring->size - 1)));
+    sqe->len = (uint32_t)len;
+    sqe->buf_index = 0;
+    sqe->user_data = (uint64_t)slot;
+    writer->sq_array[index] = index;
+    __atomic_store_n(writer->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Writer thread. It takes everything appended to the ring, splits it into writes of at most LW_CHUNK_MAX bytes
+ * and submits them in one batch, at most depth writes are in flight. The tail of the ring moves only over
+ * the written prefix, so the bytes aren't overwritten before they are in the file.
+ *
+ * @param arg Pointer to the writer.
+ * @return void* NULL.
+ */
+static void *LW_WriterThread(void *arg)
+{
+    LWWriter *writer = arg;
+    LWRing *ring = writer->ring;
+
+    // writes in flight in the order of the log, slot of a write is (first + i) % depth
+    uint64_t w_pos[LW_DEPTH_MAX];
+    size_t w_len[LW_DEPTH_MAX];
+    bool w_done[LW_DEPTH_MAX];
+    int first = 0, num = 0, pending = 0;
+    uint64_t sub = ring->tail;
+
+    while (true) {
+        // [0] - new bytes are split into writes
+        uint64_t head = __atomic_load_n(&(ring->head), __ATOMIC_SEQ_CST);
+        int queued = 0;
+        while (sub < head && (writer->backend == LW_BACKEND_PWRITE || num < writer->depth)) {
+            size_t pos = sub & (ring->size - 1), len = head - sub;
+            len = (len > LW_CHUNK_MAX) ? LW_CHUNK_MAX : len;
+            len = (len > ring->size - pos) ? ring->size - pos : len;
+            writer->writes++;
+            writer->bytes += len;
+            if (writer->backend == LW_BACKEND_PWRITE) {
+                LW_WriteAll(writer, sub, len);
+                sub += len;
+                __atomic_store_n(&(ring->tail), sub, __ATOMIC_RELEASE);
+                continue;
+            }
+            int slot = (first + num) % writer->depth;
+            w_pos[slot] = sub;
+            w_len[slot] = len;
+            w_done[slot] = false;
+            LW_UringQueue(writer, slot, sub, len);
+            num++;
+            queued++;
+            sub += len;
+        }
+
+        // [1] - io_uring - one call submits the batch and waits for a completion, new bytes meanwhile make the next
+        //       batch bigger, writes which weren't taken by the kernel (EAGAIN, EBUSY) are submitted again by the next call
+        if (num > 0) {
+            pending += queued;
+            writer->submits++;
+            long ret = syscall(__NR_io_uring_enter, writer->uring_fd, pending, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (ret > 0) {
+                pending -= (int)ret;
+            } else if (ret == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                // io_uring broke - the kernel may still read writes it took from the ring, so they have to complete
+                // before the tail moves, then the unfinished writes are written synchronously and pwrite() takes over
+                writer->error = (writer->error == 0) ? errno : writer->error;
+                int taken = -pending;
+                for (int i = 0; i < num; i++) {
+                    taken += !w_done[(first + i) % writer->depth];
+                }
+                while (taken > 0) {
+                    if (syscall(__NR_io_uring_enter, writer->uring_fd, 0, taken, IORING_ENTER_GETEVENTS, NULL, 0) == -1) {
+                        sched_yield();
+                    }
+                    taken -= LW_UringReap(writer, w_pos, w_len, w_done, false);
+                }
+                for (int i = 0; i < num; i++) {
+                    int slot = (first + i) % writer->depth;
+                    LW_WriteAll(writer, w_pos[slot], w_len[slot]);
+                }
+                __atomic_store_n(&(ring->tail), sub, __ATOMIC_RELEASE);
+                writer->backend = LW_BACKEND_PWRITE;
+                num = pending = 0;
+                continue;
+            }
+
+            // completions, short or failed writes are finished synchronously
+            LW_UringReap(writer, w_pos, w_len, w_done, true);
+
+            // tail moves over the written prefix
+            while (num > 0 && w_done[first]) {
+                __atomic_store_n(&(ring->tail), w_pos[first] + w_len[first], __ATOMIC_RELEASE);
+                first = (first + 1) % writer->depth;
+                num--;
+            }
+            continue;
+        }
+
+        // [2] - ring is empty, the writer stops when it's done or sleeps until new bytes come
+        if (__atomic_load_n(&(ring->done), __ATOMIC_SEQ_CST) && sub == __atomic_load_n(&(ring->head), __ATOMIC_SEQ_CST)) {
+            break;
+        }
+        __atomic_store_n(&(ring->sleeping), 1, __ATOMIC_SEQ_CST);
+        if (sub != __atomic_load_n(&(ring->head), __ATOMIC_SEQ_CST) || __atomic_load_n(&(ring->done), __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&(ring->sleeping), 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        while (sem_wait(&(ring->ready)) == -1 && errno == EINTR);
+    }
+    return NULL;
+}
+
+/**
+ * Starts the writer thread of the ring. Signals are blocked in the thread, so SIGCHLD is handled by the init
+ * process as before. The file is written at explicit offsets, so it's append flag is cleared, all lines have to
+ * go through the ring.
+ *
+ * @param writer (out) Pointer to the writer.
+ * @param ring Pointer to the ring.
+ * @param fd Log file.
+ * @param backend Requested backend, io_uring falls back to pwrite() if it isn't available.
+ * @param depth Max number of writes in flight <1, LW_DEPTH_MAX>.
+ * @return int returns(0) if the writer runs, returns(-1) if not.
+ */
+int LW_WriterStart(LWWriter *writer, LWRing *ring, int fd, LWBackend backend, int depth)
+{
+    memset(writer, 0, sizeof(*writer));
+    if (depth < 1 || depth > LW_DEPTH_MAX) {
+        return -1;
+    }
+    writer->ring = ring;
+    writer->fd = fd;
+    writer->depth = depth;
+    writer->backend = backend;
+
+    int flags = fcntl(fd, F_GETFL);
+    writer->base = lseek(fd, 0, SEEK_END);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags & ~O_APPEND) == -1 || writer->base == -1) {
+        return -1;
+    }
+    if (backend == LW_BACKEND_URING && LW_UringInit(writer) != 0) {
+        writer->backend = LW_BACKEND_PWRITE;
+    }
+
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int ret = pthread_create(&(writer->thread), NULL, LW_WriterThread, writer);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (ret != 0) {
+        if (writer->uring) {
+            LW_UringDestroy(writer);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Tells the writer that nothing else will be appended, waits until the ring is written and stops the thread.
+ * Should be called by the init process after all the processes finished.
+ *
+ * @param writer Pointer to the writer.
+ * @return int returns(0) if the whole log was written, returns(-1) if a write failed.
+ */
+int LW_WriterStop(LWWriter *writer)
+{
+    __atomic_store_n(&(writer->ring->done), 1, __ATOMIC_SEQ_CST);
+    LW_RingWake(writer->ring);
+    pthread_join(writer->thread, NULL);
+
+    // io_uring is set up even if the writer fell back to pwrite()
+    if (writer->uring) {
+        LW_UringDestroy(writer);
+    }
+    return (writer->error == 0) ? 0 : -1;
+}
+
+/**
+ * Prints backend and statistics of the writer.
+ *
+ * @param writer Pointer to the writer.
+ * @param file Pointer to file where the statistics will be printed.
+ */
+void LW_WriterPrint(const LWWriter *writer, FILE *file)
+{
+    fprintf(file, "log writer: %s%s, depth %d, %lu B in %lu writes, %lu system calls%s%s\n",
+            (writer->backend == LW_BACKEND_URING) ? "io_uring" : "pwrite", writer->fixed ? " (fixed buffer)" : "",
+            writer->depth, (unsigned long)writer->bytes, (unsigned long)writer->writes, (unsigned long)writer->submits,
+            (writer->error != 0) ? ", error: " : "", (writer->error != 0) ? strerror(writer->error) : "");
+}
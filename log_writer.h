@@ -0,0 +1,141 @@
+/** @file log_writer.h
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// standart libraries
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// linux libs
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/types.h>
+
+// io_uring structures (linux/io_uring.h), used only by log_writer.c
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+
+
+/* - - - - - - - - - - - -*/
+/*    TYPE DEFINITIONS    */
+/* - - - - - - - - - - - -*/
+
+/* Constant macros */
+#define LW_RING_SIZE (4 << 20)      // size of the log ring in bytes (power of 2)
+#define LW_CHUNK_MAX (256 << 10)    // max size of one write
+#define LW_DEPTH_DEFAULT 8          // default number of writes in flight
+#define LW_DEPTH_MAX 64             // max number of writes in flight
+
+
+
+/* - - - - - - - - - - - */
+/*         ENUMS         */
+/* - - - - - - - - - - - */
+
+/* How the writer writes the log */
+typedef enum {
+    // io_uring, writes of fixed (registered) buffers if the ring could be registered
+    LW_BACKEND_URING = 0,
+    // pwrite() one chunk after another (io_uring isn't available)
+    LW_BACKEND_PWRITE = 1,
+} LWBackend;
+
+
+
+/* - - - - - - - - - - - - */
+/*        LOG RING         */
+/* - - - - - - - - - - - - */
+
+/* Ring of log bytes in shared memory - processes append lines under the counter semaphore, the writer thread
+ * of the init process writes them into the file. Positions are absolute, data[pos & (size - 1)]. */
+typedef struct LWRing {
+    // bytes appended by processes and bytes written into the file
+    uint64_t head;
+    uint64_t tail;
+    // writer is blocked on ready (1) or about to be, the writer stops when done is set and the ring is empty
+    int sleeping;
+    int done;
+    sem_t ready;
+    // size of data (power of 2)
+    size_t size;
+    char data[];
+} LWRing;
+
+/* Writer thread of the log ring (process local, init process) */
+typedef struct LWWriter {
+    LWRing *ring;
+    // log file and offset of the first byte of the ring in it
+    int fd;
+    off_t base;
+    // backend, number of writes in flight and whether the ring is registered (io_uring fixed buffers)
+    LWBackend backend;
+    int depth;
+    bool fixed;
+    // io_uring is set up, it stays until the writer stops even if the writer fell back to pwrite()
+    bool uring;
+    pthread_t thread;
+    // io_uring - submission and completion queues mapped from the kernel
+    int uring_fd;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned int *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    // statistics - writes, calls of io_uring_enter() / pwrite() and written bytes
+    uint64_t writes;
+    uint64_t submits;
+    uint64_t bytes;
+    // first error of a write (errno), (0) if there was none
+    int error;
+} LWWriter;
+
+
+
+/* - - - - - - - - - - - - - - - - */
+/*       LW_RING FUNCTIONS         */
+/* - - - - - - - - - - - - - - - - */
+
+/* Number of bytes of shared memory of a ring with size bytes of data */
+size_t LW_RingBytes(size_t size);
+
+/* Initializes the ring in shared memory */
+int LW_RingInit(LWRing *ring, size_t size);
+
+/* Appends bytes to the ring, callers have to be serialized (counter semaphore) */
+void LW_RingAppend(LWRing *ring, const void *data, size_t len);
+
+/* Wakes the writer up if it's sleeping */
+void LW_RingWake(LWRing *ring);
+
+/* Destroys semaphore of the ring */
+int LW_RingDestroy(LWRing *ring);
+
+
+
+/* - - - - - - - - - - - - - - - - */
+/*      LW_WRITER FUNCTIONS        */
+/* - - - - - - - - - - - - - - - - */
+
+/* Starts writer thread of the ring */
+int LW_WriterStart(LWWriter *writer, LWRing *ring, int fd, LWBackend backend, int depth);
+
+/* Waits until the ring is written and stops the writer thread */
+int LW_WriterStop(LWWriter *writer);
+
+/* Prints backend and statistics of the writer */
+void LW_WriterPrint(const LWWriter *writer, FILE *file);
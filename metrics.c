@@ -0,0 +1,146 @@
+/** @file metrics.c
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+
+#include "metrics.h"
+
+
+
+/* - - - - - - - - - - - - - - */
+/*   MT_HISTOGRAM FUNCTIONS    */
+/* - - - - - - - - - - - - - - */
+// Histograms of times (waits, services), recorded by all processes and read by the init process
+
+/**
+ * Returns index of the bucket of a value. Values smaller than MT_SUB_COUNT have their own bucket, bigger values
+ * are split into powers of two and every power of two is split into MT_SUB_COUNT linear sub-buckets.
+ *
+ * @param value Recorded value
+ * @return unsigned int Index of the bucket
+ */
+static unsigned int MT_BucketIndex(uint64_t value)
+{
+    if (value < MT_SUB_COUNT) {
+        return (unsigned int)value;
+    }
+    unsigned int exp = 63 - __builtin_clzll(value);
+    unsigned int sub = (unsigned int)(value >> (exp - MT_SUB_BITS)) & (MT_SUB_COUNT - 1);
+    return (exp - MT_SUB_BITS + 1) * MT_SUB_COUNT + sub;
+}
+
+/**
+ * Returns the highest value which belongs to a bucket.
+ *
+ * @param index Index of the bucket
+ * @return uint64_t Upper bound of the bucket
+ */
+static uint64_t MT_BucketUpper(unsigned int index)
+{
+    if (index < MT_SUB_COUNT) {
+        return index;
+    }
+    unsigned int exp = index / MT_SUB_COUNT + MT_SUB_BITS - 1;
+    uint64_t sub = index % MT_SUB_COUNT;
+    uint64_t lower = (MT_SUB_COUNT + sub) << (exp - MT_SUB_BITS);
+    return lower + (1ULL << (exp - MT_SUB_BITS)) - 1;
+}
+
+/**
+ * Records one value into the histogram, can be called by any process at any time.
+ *
+ * @param hist Pointer to histogram in shared memory
+ * @param value Recorded value
+ */
+void MT_HistogramRecord(MTHistogram *hist, uint64_t value)
+{
+    __atomic_fetch_add(&(hist->bucket[MT_BucketIndex(value)]), 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(hist->count), 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(hist->sum), value, __ATOMIC_RELAXED);
+
+    // updating maximum
+    uint64_t max = __atomic_load_n(&(hist->max), __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&(hist->max), &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * Returns value of the given percentile (upper bound of the bucket which contains it, but never more than maximum).
+ *
+ * @param hist Pointer to histogram
+ * @param percentile Percentile in interval <0, 100>
+ * @return uint64_t Value of the percentile, (0) if the histogram is empty
+ */
+uint64_t MT_HistogramPercentile(const MTHistogram *hist, double percentile)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    // rank of the searched value
+    uint64_t rank = (uint64_t)(percentile / 100.0 * hist->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < MT_BUCKETS; i++) {
+        seen += hist->bucket[i];
+        if (seen >= rank) {
+            uint64_t upper = MT_BucketUpper(i);
+            return (upper < hist->max) ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+/**
+ * Returns mean of the recorded values.
+ *
+ * @param hist Pointer to histogram
+ * @return double Mean, (0) if the histogram is empty
+ */
+double MT_HistogramMean(const MTHistogram *hist)
+{
+    return (hist->count == 0) ? 0.0 : (double)hist->sum / hist->count;
+}
+
+/**
+ * Copies histogram which can be recorded into by other processes. The copy isn't atomic as a whole, but every
+ * counter is read atomically.
+ *
+ * @param dst Pointer to the copy
+ * @param src Pointer to histogram in shared memory
+ */
+void MT_HistogramSnapshot(MTHistogram *dst, const MTHistogram *src)
+{
+    dst->count = __atomic_load_n(&(src->count), __ATOMIC_RELAXED);
+    dst->sum = __atomic_load_n(&(src->sum), __ATOMIC_RELAXED);
+    dst->max = __atomic_load_n(&(src->max), __ATOMIC_RELAXED);
+    for (unsigned int i = 0; i < MT_BUCKETS; i++) {
+        dst->bucket[i] = __atomic_load_n(&(src->bucket[i]), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Creates histogram of values recorded between two snapshots (windowed metrics). Maximum of the window is the upper
+ * bound of it's highest bucket.
+ *
+ * @param dst Pointer to histogram of the window
+ * @param cur Pointer to the newer snapshot
+ * @param prev Pointer to the older snapshot
+ */
+void MT_HistogramDiff(MTHistogram *dst, const MTHistogram *cur, const MTHistogram *prev)
+{
+    dst->count = cur->count - prev->count;
+    dst->sum = cur->sum - prev->sum;
+    dst->max = 0;
+    for (unsigned int i = 0; i < MT_BUCKETS; i++) {
+        dst->bucket[i] = cur->bucket[i] - prev->bucket[i];
+        if (dst->bucket[i] > 0) {
+            dst->max = MT_BucketUpper(i);
+        }
+    }
+    if (dst->max > cur->max) {
+        dst->max = cur->max;
+    }
+}
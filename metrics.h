@@ -0,0 +1,64 @@
+/** @file metrics.h
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// standart libraries
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+
+
+/* - - - - - - - - - - - -*/
+/*    TYPE DEFINITIONS    */
+/* - - - - - - - - - - - -*/
+
+/* Constant macros */
+#define MT_SUB_BITS 3                                   // log2 of number of linear sub-buckets in every power of two
+#define MT_SUB_COUNT (1 << MT_SUB_BITS)                 // number of linear sub-buckets in every power of two
+#define MT_BUCKETS ((64 - MT_SUB_BITS + 1) * MT_SUB_COUNT)   // number of buckets covering whole uint64_t
+
+
+
+/* - - - - - - - - - - - - */
+/*      METRICS DATA       */
+/* - - - - - - - - - - - - */
+
+/* Log-linear histogram of values (relative error is 1/MT_SUB_COUNT), it lives in shared memory and 
+ * every process records into it with atomic operations, so it doesn't need any semaphore. */
+typedef struct MTHistogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t bucket[MT_BUCKETS];
+} MTHistogram;
+
+
+
+/* - - - - - - - - - - - - - - - - */
+/*     MT_HISTOGRAM FUNCTIONS      */
+/* - - - - - - - - - - - - - - - - */
+
+/* Records one value into the histogram */
+void MT_HistogramRecord(MTHistogram *hist, uint64_t value);
+
+/* Returns value of the given percentile <0, 100> */
+uint64_t MT_HistogramPercentile(const MTHistogram *hist, double percentile);
+
+/* Returns mean of the recorded values */
+double MT_HistogramMean(const MTHistogram *hist);
+
+/* Copies histogram which is being recorded into */
+void MT_HistogramSnapshot(MTHistogram *dst, const MTHistogram *src);
+
+/* Histogram of values recorded between two snapshots */
+void MT_HistogramDiff(MTHistogram *dst, const MTHistogram *cur, const MTHistogram *prev);
@@ -0,0 +1,186 @@
+/**
+ * @file office-bench.cpp
+ * @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ * @brief Compares the dispatch of the C office (SM_OfficeEnter() + SM_OfficeCall()) with the templated office.hpp.
+ *        Customers enter the office in batches and one officer calls them all, time per customer is printed.
+ * @date 2023-04-24
+ */
+
+/* - - - - - - - - - - -*/
+/*      DEFINITIONS     */
+/* - - - - - - - - - - -*/
+
+/* libraries */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "office.hpp"
+
+/* constants */
+#define PROGRAM_NAME "office-bench.cpp"
+#define BENCH_ITERATIONS 2000     // default number of batches
+#define BENCH_BATCH 256           // default number of customers in one batch
+
+
+
+/* - - - - - - - - - - -*/
+/*       BENCHMARKS     */
+/* - - - - - - - - - - -*/
+
+/* pseudo random services, same sequence for every benchmark */
+static int bench_service(unsigned int *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return 1 + (int)((*state >> 16) % SERVICE_NUM);
+}
+
+/**
+ * Dispatch of the C office with the given policy.
+ *
+ * @return double Nanoseconds per customer, negative on error.
+ */
+static double bench_c(const char *policy, int iterations, int batch)
+{
+    char *keys[] = {(char *)"Z", (char *)"U"};
+    const size_t sizes[] = {1, 1};
+    PTList *list = PT_InitCapacity(2, keys, sizes);
+    if (list == NULL) {
+        return -1.0;
+    }
+    PTListDataPtr shared_data = list->shared_data;
+    if (SM_CounterInit(shared_data) + SM_OfficeInit(shared_data, batch, 1) != 0 ||
+        SM_OfficeSetPolicy(shared_data, policy) != 0) {
+        PT_Destroy(&list);
+        return -1.0;
+    }
+
+    unsigned int state = 1;
+    long checksum = 0;
+    uint64_t start = nsec_now();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < batch; i++) {
+            SM_OfficeEnter(shared_data, NULL, i, i, bench_service(&state));
+        }
+        for (int i = 0; i < batch; i++) {
+            checksum += SM_OfficeCall(shared_data, 0);
+        }
+    }
+    uint64_t elapsed = nsec_now() - start;
+
+    SM_OfficeDestroy(shared_data);
+    SM_CounterDestroy(shared_data);
+    PT_Destroy(&list);
+    return (checksum < 0) ? -1.0 : (double)elapsed / ((double)iterations * batch);
+}
+
+/**
+ * Dispatch of the templated office with the given policy.
+ *
+ * @return double Nanoseconds per customer, negative on error.
+ */
+template<class Policy>
+static double bench_template(int iterations, int batch)
+{
+    office::Office<SERVICE_NUM, Policy> off;
+    if (off.create(batch) != PT_OK) {
+        return -1.0;
+    }
+
+    unsigned int state = 1;
+    long checksum = 0;
+    uint64_t start = nsec_now();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < batch; i++) {
+            off.enter(i, bench_service(&state));
+        }
+        for (int i = 0; i < batch; i++) {
+            checksum += off.call();
+        }
+    }
+    uint64_t elapsed = nsec_now() - start;
+
+    return (checksum < 0) ? -1.0 : (double)elapsed / ((double)iterations * batch);
+}
+
+/**
+ * Full round trip of the templated office - enter, call, wake and wait of every customer.
+ *
+ * @return double Nanoseconds per customer, negative on error.
+ */
+template<class Wait>
+static double bench_round_trip(int iterations, int batch)
+{
+    office::Office<SERVICE_NUM, office::Longest, Wait> off;
+    if (off.create(batch) != PT_OK) {
+        return -1.0;
+    }
+
+    unsigned int state = 1;
+    uint64_t start = nsec_now();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < batch; i++) {
+            off.enter(i, bench_service(&state));
+        }
+        for (int i = 0; i < batch; i++) {
+            int index = off.call();
+            off.wake(index, 0);
+            if (off.wait(index) != PT_OK) {
+                return -1.0;
+            }
+        }
+    }
+    uint64_t elapsed = nsec_now() - start;
+
+    return (double)elapsed / ((double)iterations * batch);
+}
+
+
+
+/* - - - - - - - - - - -*/
+/*         MAIN         */
+/* - - - - - - - - - - -*/
+
+/* usage: office-bench [ITERATIONS] [BATCH] */
+int main(int argc, char *argv[])
+{
+    // [0] - parse arguments
+    int iterations = (argc >= 2) ? atoi(argv[1]) : BENCH_ITERATIONS;
+    int batch = (argc >= 3) ? atoi(argv[2]) : BENCH_BATCH;
+    if (argc > 3 || iterations <= 0 || batch <= 0) {
+        fprintf(stderr, "[%s] - Wrong arguments, usage: %s [ITERATIONS] [BATCH]\n", PROGRAM_NAME, argv[0]);
+        return 1;
+    }
+
+    // [1] - dispatch, C office against the template
+    struct {
+        const char *name;
+        double c_ns;
+        double t_ns;
+    } rows[] = {
+        {"longest", bench_c("longest", iterations, batch), bench_template<office::Longest>(iterations, batch)},
+        {"oldest", bench_c("oldest", iterations, batch), bench_template<office::Oldest>(iterations, batch)},
+        {"rr", bench_c("rr", iterations, batch), bench_template<office::RoundRobin>(iterations, batch)},
+    };
+
+    printf("dispatch (enter + call), %d x %d customers\n", iterations, batch);
+    printf("%-10s %12s %12s %8s\n", "policy", "C ns/op", "C++ ns/op", "speedup");
+    for (const auto &row : rows) {
+        if (row.c_ns < 0 || row.t_ns < 0) {
+            fprintf(stderr, "[%s] - Benchmark of policy %s failed\n", PROGRAM_NAME, row.name);
+            return 1;
+        }
+        printf("%-10s %12.1f %12.1f %7.2fx\n", row.name, row.c_ns, row.t_ns, row.c_ns / row.t_ns);
+    }
+
+    // [2] - round trip of the templated office with both wait strategies
+    double sem_ns = bench_round_trip<office::SemaphoreWait>(iterations, batch);
+    double spin_ns = bench_round_trip<office::SpinWait>(iterations, batch);
+    if (sem_ns < 0 || spin_ns < 0) {
+        fprintf(stderr, "[%s] - Round trip benchmark failed\n", PROGRAM_NAME);
+        return 1;
+    }
+    printf("round trip (enter + call + wake + wait)\n");
+    printf("%-10s %12.1f\n%-10s %12.1f\n", "semaphore", sem_ns, "spin", spin_ns);
+
+    return 0;
+}
@@ -0,0 +1,390 @@
+/** @file office.hpp
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ *  @brief Header-only office with number of services, dispatch policy and wait strategy known at compile time.
+ *         Shard and customer records have the same layout as in process_table.h, only the number of queues
+ *         is a template parameter, so the dispatch in the officer hot path is fully inlined.
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// standart libraries
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// custom libraries
+extern "C" {
+#include "process_table.h"
+}
+
+
+
+/* - - - - - - - - - - - -*/
+/*    TYPE DEFINITIONS    */
+/* - - - - - - - - - - - -*/
+
+namespace office {
+
+/* Constant macros */
+constexpr int SPIN_TRIES = 64;      // number of sem_trywait() tries of the spinning wait strategy
+
+/* Shard of the office with N queues, same layout as SM_Shard */
+template<int N>
+struct Shard {
+    // mutex guarding the queues of the shard
+    sem_t mutex;
+    // last served service (round robin, tie breaking) and virtual time (weighted fair queueing)
+    int last_service;
+    double vtime;
+    // queues of services 1 .. N
+    SM_Queue queue[N];
+};
+
+static_assert(sizeof(Shard<SERVICE_NUM>) == sizeof(SM_Shard), "Shard<SERVICE_NUM> must match SM_Shard");
+static_assert(offsetof(Shard<SERVICE_NUM>, queue) == offsetof(SM_Shard, queue), "Shard<SERVICE_NUM> must match SM_Shard");
+
+
+
+/* - - - - - - - - - - - - */
+/*    DISPATCH POLICIES    */
+/* - - - - - - - - - - - - */
+
+/* Dispatch policy - service with the longest queue, ties are broken by starting after the last served service */
+struct Longest {
+    template<int N>
+    static inline int pick(const Shard<N> &shard, const SM_Customer *)
+    {
+        int best = -1;
+        for (int k = 1; k <= N; k++) {
+            int i = (shard.last_service + k) % N;
+            if (shard.queue[i].count > 0 && (best == -1 || shard.queue[i].count > shard.queue[best].count)) {
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+
+/* Dispatch policy - service whose first customer entered the office first */
+struct Oldest {
+    template<int N>
+    static inline int pick(const Shard<N> &shard, const SM_Customer *cust)
+    {
+        int best = -1;
+        for (int i = 0; i < N; i++) {
+            if (shard.queue[i].count > 0 && (best == -1 ||
+                cust[shard.queue[i].head].t_enter < cust[shard.queue[best].head].t_enter)) {
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+
+/* Dispatch policy - the first non-empty service after the last served service */
+struct RoundRobin {
+    template<int N>
+    static inline int pick(const Shard<N> &shard, const SM_Customer *)
+    {
+        for (int k = 1; k <= N; k++) {
+            int i = (shard.last_service + k) % N;
+            if (shard.queue[i].count > 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+
+
+/* - - - - - - - - - - - - */
+/*     WAIT STRATEGIES     */
+/* - - - - - - - - - - - - */
+
+/* Customer blocks on his semaphore right away */
+struct SemaphoreWait {
+    static inline int wait(sem_t *sem)
+    {
+        while (sem_wait(sem) == -1) {
+            if (errno != EINTR) {
+                return PT_ERR_SYS;
+            }
+        }
+        return PT_OK;
+    }
+};
+
+/* Customer tries his semaphore SPIN_TRIES times yielding the processor in between, then he blocks */
+struct SpinWait {
+    static inline int wait(sem_t *sem)
+    {
+        for (int i = 0; i < SPIN_TRIES; i++) {
+            if (sem_trywait(sem) == 0) {
+                return PT_OK;
+            }
+            sched_yield();
+        }
+        return SemaphoreWait::wait(sem);
+    }
+};
+
+
+
+/* - - - - - - - - - - - - */
+/*         OFFICE          */
+/* - - - - - - - - - - - - */
+
+/**
+ * Office with NumServices services and one shard, customers are indexed by their record the same way as in
+ * SM_OfficeService(). All the data live in one anonymous shared memory, so the object has to be created before fork().
+ *
+ * @tparam NumServices Number of services of the office.
+ * @tparam DispatchPolicy Policy choosing the served service (Longest, Oldest, RoundRobin).
+ * @tparam WaitStrategy How the customer waits for his officer (SemaphoreWait, SpinWait).
+ */
+template<int NumServices, class DispatchPolicy, class WaitStrategy = SemaphoreWait>
+class Office {
+    static_assert(NumServices > 0, "office needs at least one service");
+
+    /* Layout of the shared memory, customer records follow the header */
+    struct Header {
+        int is_open;
+        int cust_num;
+        Shard<NumServices> shard;
+    };
+
+public:
+    Office() = default;
+    Office(const Office &) = delete;
+    Office &operator=(const Office &) = delete;
+    ~Office() { destroy(); }
+
+    /**
+     * Creates the shared memory of the office and opens it.
+     *
+     * @param customer_num Number of customer records.
+     * @return int PT_OK, PT_ERR_ARG if the number of customers is wrong, PT_ERR_SYS if mmap or sem_init failed.
+     */
+    int create(int customer_num)
+    {
+        if (customer_num <= 0 || m_header != nullptr) {
+            return PT_ERR_ARG;
+        }
+
+        m_size = sizeof(Header) + customer_num * sizeof(SM_Customer);
+        void *mem = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return PT_ERR_SYS;
+        }
+        m_header = new (mem) Header();
+        m_cust = reinterpret_cast<SM_Customer *>(static_cast<char *>(mem) + sizeof(Header));
+
+        // [0] - shard with empty queues
+        Shard<NumServices> &shard = m_header->shard;
+        int err_check = sem_init(&(shard.mutex), 1, 1);
+        shard.last_service = NumServices - 1;
+        shard.vtime = 0.0;
+        for (int i = 0; i < NumServices; i++) {
+            shard.queue[i] = SM_Queue{-1, -1, 0, 0, 0.0, SM_SPIN_MAX_NS / 2};
+        }
+
+        // [1] - customer records
+        for (int i = 0; i < customer_num; i++) {
+            err_check += sem_init(&(m_cust[i].sem), 1, 0);
+            m_cust[i].next = -1;
+            m_cust[i].next_free = -1;
+        }
+        m_header->cust_num = customer_num;
+        m_header->is_open = 1;
+        m_creator = getpid();
+
+        return (err_check == 0) ? PT_OK : PT_ERR_SYS;
+    }
+
+    /**
+     * Destroys semaphores and unmaps the shared memory. Copies of the office in forked processes only unmap it,
+     * the semaphores are destroyed by the creating process, other processes can still use them.
+     */
+    void destroy()
+    {
+        if (m_header == nullptr) {
+            return;
+        }
+        if (m_creator == getpid()) {
+            sem_destroy(&(m_header->shard.mutex));
+            for (int i = 0; i < m_header->cust_num; i++) {
+                sem_destroy(&(m_cust[i].sem));
+            }
+        }
+        munmap(m_header, m_size);
+        m_header = nullptr;
+        m_cust = nullptr;
+    }
+
+    /**
+     * Customer enters the office and goes to the end of the queue of his service.
+     *
+     * @param record Index of the customer record.
+     * @param service Type of the service <1, NumServices>.
+     * @return int PT_OK if the customer entered, PT_CLOSED if the office is closed, PT_ERR_ARG if the arguments are wrong.
+     */
+    inline int enter(int record, int service)
+    {
+        if (service < 1 || service > NumServices || record < 0 || record >= m_header->cust_num) {
+            return PT_ERR_ARG;
+        }
+
+        Shard<NumServices> &shard = m_header->shard;
+        lock(shard);
+        if (m_header->is_open == 0) {
+            sem_post(&(shard.mutex));
+            return PT_CLOSED;
+        }
+
+        SM_Customer &cust = m_cust[record];
+        cust.service = service;
+        cust.shard = 0;
+        cust.t_enter = nsec_now();
+        push(shard.queue[service - 1], record);
+        sem_post(&(shard.mutex));
+
+        return PT_OK;
+    }
+
+    /**
+     * Customer waits until he is called by an officer.
+     *
+     * @param record Index of the customer record.
+     * @return int PT_OK when the customer was called, PT_ERR_SYS if waiting failed.
+     */
+    inline int wait(int record)
+    {
+        PT_ProcessSleep(true);
+        int ret = WaitStrategy::wait(&(m_cust[record].sem));
+        PT_ProcessSleep(false);
+        return ret;
+    }
+
+    /**
+     * Officer calls the first customer of the service chosen by DispatchPolicy, without waking him up.
+     *
+     * @return int Index of the record of the called customer, (-1) if nobody is waiting.
+     */
+    inline int call()
+    {
+        Shard<NumServices> &shard = m_header->shard;
+        int index = -1;
+
+        lock(shard);
+        int i = DispatchPolicy::pick(shard, m_cust);
+        if (i >= 0) {
+            shard.last_service = i;
+            index = pop(shard.queue[i]);
+        }
+        sem_post(&(shard.mutex));
+
+        return index;
+    }
+
+    /**
+     * Officer wakes the called customer up.
+     *
+     * @param record Index of the record returned by call().
+     * @param timeout Service time in microseconds.
+     */
+    inline void wake(int record, unsigned int timeout)
+    {
+        m_cust[record].timeout = timeout;
+        sem_post(&(m_cust[record].sem));
+    }
+
+    /**
+     * Closes the office, customers who didn't enter yet are turned away.
+     */
+    void close()
+    {
+        lock(m_header->shard);
+        m_header->is_open = 0;
+        sem_post(&(m_header->shard.mutex));
+    }
+
+    /**
+     * @return int Number of customers waiting in all queues.
+     */
+    int waiting()
+    {
+        Shard<NumServices> &shard = m_header->shard;
+        int count = 0;
+        lock(shard);
+        for (int i = 0; i < NumServices; i++) {
+            count += shard.queue[i].count;
+        }
+        sem_post(&(shard.mutex));
+        return count;
+    }
+
+    /**
+     * @return size_t Number of bytes of shared memory used by the office.
+     */
+    size_t footprint() const { return m_size; }
+
+private:
+    static inline void lock(Shard<NumServices> &shard)
+    {
+        while (sem_wait(&(shard.mutex)) == -1 && errno == EINTR);
+    }
+
+    // same as SM_QueuePush(), caller must hold the mutex of the shard
+    inline void push(SM_Queue &queue, int index)
+    {
+        m_cust[index].next = -1;
+        m_cust[index].prev = queue.tail;
+        m_cust[index].queued = true;
+        if (queue.tail == -1) {
+            queue.head = index;
+        } else {
+            m_cust[queue.tail].next = index;
+        }
+        queue.tail = index;
+
+        queue.count++;
+        if (queue.count > queue.max_count) {
+            queue.max_count = queue.count;
+        }
+    }
+
+    // same as SM_QueuePop(), queue must not be empty
+    inline int pop(SM_Queue &queue)
+    {
+        int index = queue.head;
+        queue.head = m_cust[index].next;
+        if (queue.head == -1) {
+            queue.tail = -1;
+        } else {
+            m_cust[queue.head].prev = -1;
+        }
+        m_cust[index].queued = false;
+        queue.count--;
+        return index;
+    }
+
+    Header *m_header = nullptr;
+    SM_Customer *m_cust = nullptr;
+    size_t m_size = 0;
+    // process which created the office, forked copies only unmap it
+    pid_t m_creator = 0;
+};
+
+} // namespace office
@@ -0,0 +1,87 @@
+/** @file office_client.c
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+
+#include "office_client.h"
+
+
+
+/* - - - - - - - - - - - - - - */
+/*     OC_CLIENT FUNCTIONS     */
+/* - - - - - - - - - - - - - - */
+// Functions used by programs which weren't forked from the office, customers of these programs use the same
+// protocol as customers of the office (SM_OfficeService())
+
+/**
+ * Attaches named office and opens it's log file for appending, so lines of external customers are numbered
+ * by the same counter as lines of the office.
+ * 
+ * @param client Pointer to the client.
+ * @param name Name of the office given to PT_InitNamed().
+ * @return int returns(0) if the office was attached, returns(-1) if not.
+ */
+int OC_Attach(OCClient *client, const char *name)
+{
+    client->shared_data = SM_OfficeAttach(name);
+    if (client->shared_data == NULL) {
+        return -1;
+    }
+
+    client->log_file = fopen(client->shared_data->office.log_path, "a");
+    if (client->log_file == NULL) {
+        fprintf(stderr, "ERROR - OC_Attach, log file can't be opened\n");
+        SM_OfficeDetach(client->shared_data);
+        return -1;
+    }
+    setbuf(client->log_file, NULL);
+    return 0;
+}
+
+/**
+ * One customer of the client program goes to the office - he gets a number and a free record, enters the office
+ * and waits until he's served.
+ * 
+ * @param client Pointer to the client.
+ * @param type_of_service Type of the requested service <1, SERVICE_NUM>.
+ * @return int return(0) if the customer was served, return(1) if the office is closed, return(2) if all records 
+ *             of external clients are taken, PT_REJECTED if the queue was full, PT_RENEGED if the customer left
+ *             the queue, otherwise returns(-1)
+ */
+int OC_Service(OCClient *client, int type_of_service)
+{
+    PTListDataPtr shared_data = client->shared_data;
+
+    // [0] - customer needs a record, there is a limited number of external clients in the office
+    int record = SM_OfficeRecordAcquire(shared_data);
+    if (record == -1) {
+        return 2;
+    }
+    int id = __atomic_fetch_add(&(shared_data->office.client_id), 1, __ATOMIC_RELAXED);
+
+    // [1] - customer goes to the office like customers of the office do
+    SM_CounterEvent(shared_data, client->log_file, EV_Z_START, id, 0);
+
+    int ret = SM_OfficeService(shared_data, client->log_file, id, record, type_of_service);
+
+    SM_OfficeGoHome(shared_data, client->log_file, "Z", id);
+
+    // [2] - record can be used by another customer
+    SM_OfficeRecordRelease(shared_data, record);
+    return ret;
+}
+
+/**
+ * Detaches the office and closes it's log file.
+ * 
+ * @param client Pointer to the client.
+ * @return int returns(0) if the office was detached, returns(-1) if not.
+ */
+int OC_Detach(OCClient *client)
+{
+    int err_check = fclose(client->log_file);
+    err_check += SM_OfficeDetach(client->shared_data);
+    client->shared_data = NULL;
+    client->log_file = NULL;
+    return (err_check == 0) ? 0 : -1;
+}
@@ -0,0 +1,43 @@
+/** @file office_client.h
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// project modules
+#include "process_table.h"
+
+
+
+/* - - - - - - - - - - - - */
+/*       CLIENT DATA       */
+/* - - - - - - - - - - - - */
+
+/* External client of a named office (see PT_InitNamed()), every call of OC_Service() is one customer */
+typedef struct OCClient {
+    // shared data of the attached office
+    PTListDataPtr shared_data;
+    // log file of the office opened for appending
+    FILE *log_file;
+} OCClient;
+
+
+
+/* - - - - - - - - - - - - - - - */
+/*     OC_CLIENT FUNCTIONS       */
+/* - - - - - - - - - - - - - - - */
+
+/* Attaches named office */
+int OC_Attach(OCClient *client, const char *name);
+
+/* Customer gets service in the attached office */
+int OC_Service(OCClient *client, int type_of_service);
+
+/* Detaches the office */
+int OC_Detach(OCClient *client);
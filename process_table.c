@@ -3,6 +3,8 @@
  *  @date 2023-04-24
  */
 
+// sem_clockwait() waits for monotonic deadlines
+#define _GNU_SOURCE
 #include "process_table.h"
 
 
@@ -12,58 +14,471 @@
 /* - - - - - - - - - - - - */
 // Functions which work with process data nodes (PTList)
 
+/* Process table reaped by the SIGCHLD handler of the init process and the handler which was there before it */
+static PTList *PT_ReapList = NULL;
+static struct sigaction PT_OldSigChld;
+
+/* Slot of the calling process and it's tag, set in the new process by PT_ProcessCreate() (process local) */
+static PTProcessPtr PT_Self = NULL;
+static PTListTagPtr PT_SelfTag = NULL;
+static int PT_SelfSlot = -1;
+
+/* Segments of tags mapped by the calling process (process local), inherited by processes forked after their creation */
+static PTProcessPtr PT_SegMap[PT_TAG_MAX][PT_SEG_MAX];
+
+/* Index pid -> (tag, slot) of living children of the init process (process local), open addressing with linear
+ * probing, filled by PT_ProcessCreate() and emptied by PT_ProcessReap(), both run with SIGCHLD blocked or in it's 
+ * handler, so they never interleave */
+typedef struct PTPidEntry {
+    pid_t pid;      // (0) if the entry is free
+    unsigned int tag;
+    unsigned int slot;
+} PTPidEntry;
+static PTPidEntry *PT_PidMap = NULL;
+static size_t PT_PidCap = 0;
+static size_t PT_PidNum = 0;
+
+/**
+ * Home position of a pid in the index (PT_PidCap is a power of 2).
+ * 
+ * @param pid Process ID.
+ * @return size_t Index of the entry.
+ */
+static inline size_t PT_PidHash(pid_t pid)
+{
+    return ((uint32_t)pid * 2654435761u) & (PT_PidCap - 1);
+}
+
+/**
+ * Makes room for one more pid, the index is at most half full. Must be called with SIGCHLD blocked.
+ * 
+ * @return int Returns(0) if there is room, (-1) if the index couldn't grow.
+ */
+static int PT_PidReserve(void)
+{
+    if ((PT_PidNum + 1) * 2 <= PT_PidCap) {
+        return 0;
+    }
+
+    size_t cap = (PT_PidCap == 0) ? 1024 : PT_PidCap * 2;
+    PTPidEntry *map = mmap(NULL, cap * sizeof(PTPidEntry), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    PTPidEntry *old = PT_PidMap;
+    size_t old_cap = PT_PidCap;
+    PT_PidMap = map;
+    PT_PidCap = cap;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].pid != 0) {
+            size_t j = PT_PidHash(old[i].pid);
+            while (PT_PidMap[j].pid != 0) {
+                j = (j + 1) & (cap - 1);
+            }
+            PT_PidMap[j] = old[i];
+        }
+    }
+    if (old != NULL) {
+        munmap(old, old_cap * sizeof(PTPidEntry));
+    }
+    return 0;
+}
+
+/**
+ * Adds a child to the index, PT_PidReserve() has to be called before. Must be called with SIGCHLD blocked.
+ * 
+ * @param pid Process ID of the child.
+ * @param tag Index of the tag of the child.
+ * @param slot Slot of the child in the tag.
+ */
+static void PT_PidInsert(pid_t pid, unsigned int tag, unsigned int slot)
+{
+    size_t i = PT_PidHash(pid);
+    while (PT_PidMap[i].pid != 0) {
+        i = (i + 1) & (PT_PidCap - 1);
+    }
+    PT_PidMap[i] = (PTPidEntry){pid, tag, slot};
+    PT_PidNum++;
+}
+
+/**
+ * Removes a child from the index, entries after it are shifted back, so lookups don't need tombstones.
+ * Async-signal-safe.
+ * 
+ * @param pid Process ID of the child.
+ * @param entry (return) Tag and slot of the child.
+ * @return int Returns(0) if the child was in the index, (-1) if not.
+ */
+static int PT_PidRemove(pid_t pid, PTPidEntry *entry)
+{
+    if (PT_PidCap == 0) {
+        return -1;
+    }
+    size_t mask = PT_PidCap - 1, i = PT_PidHash(pid);
+    while (PT_PidMap[i].pid != pid) {
+        if (PT_PidMap[i].pid == 0) {
+            return -1;
+        }
+        i = (i + 1) & mask;
+    }
+    *entry = PT_PidMap[i];
+
+    // backward shift deletion, an entry moves to the hole if the hole is between it's home and it's position
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; PT_PidMap[j].pid != 0; j = (j + 1) & mask) {
+        size_t home = PT_PidHash(PT_PidMap[j].pid);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            PT_PidMap[hole] = PT_PidMap[j];
+            hole = j;
+        }
+    }
+    PT_PidMap[hole].pid = 0;
+    PT_PidNum--;
+    return 0;
+}
+
+/**
+ * Name of a segment of a tag in the shared memory, it's unique for every process table.
+ * 
+ * @param list Pointer to PTList
+ * @param tag Index of the tag
+ * @param seg Index of the segment
+ * @param name (return) Buffer for the name, PT_SEG_NAME_SIZE long
+ */
+static void PT_SegName(PTList *list, unsigned int tag, unsigned int seg, char *name)
+{
+    snprintf(name, PT_SEG_NAME_SIZE, "/ptable.%d.%u.%u", (int)list->init_pid.pid, tag, seg);
+}
+
+/**
+ * Number of slots in a segment, segment 0 has p_base slots and every next segment doubles capacity of the tag.
+ * 
+ * @param tag_ptr Pointer to the tag
+ * @param seg Index of the segment
+ * @return size_t Number of slots
+ */
+static size_t PT_SegSize(PTListTagPtr tag_ptr, unsigned int seg)
+{
+    return (seg == 0) ? tag_ptr->p_base : tag_ptr->p_base << (seg - 1);
+}
+
+/**
+ * Creates new segment of the tag in named shared memory. Processes which were forked before attach it by it's name.
+ * 
+ * @param list Pointer to PTList
+ * @param tag_ptr Pointer to the tag
+ * @return int Returns(0) if the segment was created, returns(-1) if the tag can't grow.
+ */
+static int PT_SegGrow(PTList *list, PTListTagPtr tag_ptr)
+{
+    unsigned int tag = tag_ptr - list->t_arr;
+    unsigned int seg = tag_ptr->seg_num;
+    if (seg == PT_SEG_MAX) {
+        return -1;
+    }
+
+    char name[PT_SEG_NAME_SIZE];
+    PT_SegName(list, tag, seg, name);
+    size_t size = PT_SegSize(tag_ptr, seg) * sizeof(struct PTProcess);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        return -1;
+    }
+    if (ftruncate(fd, size) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    PTProcessPtr seg_ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg_ptr == MAP_FAILED) {
+        shm_unlink(name);
+        return -1;
+    }
+
+    // segment is published before the capacity, so every slot below p_num is in a created segment
+    PT_SegMap[tag][seg] = seg_ptr;
+    tag_ptr->seg_num++;
+    __atomic_store_n(&(tag_ptr->p_cap), tag_ptr->p_cap + PT_SegSize(tag_ptr, seg), __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Returns slot of a process in the tag. Segment 0 is mapped before fork, other segments are attached by name
+ * the first time the calling process touches them.
+ * 
+ * @param list Pointer to PTList
+ * @param tag_ptr Pointer to the tag
+ * @param slot Index of the slot in the tag (less than p_num)
+ * @return PTProcessPtr Pointer to the slot, or NULL if the segment couldn't be attached
+ */
+extern PTProcessPtr PT_Slot(PTList *list, PTListTagPtr tag_ptr, unsigned int slot)
+{
+    if (slot < tag_ptr->p_base) {
+        return &(tag_ptr->p_arr[slot]);
+    }
+
+    // segment k >= 1 holds slots <p_base * 2^(k-1), p_base * 2^k)
+    unsigned int seg = 32 - __builtin_clz((unsigned int)(slot / tag_ptr->p_base));
+    size_t offset = slot - PT_SegSize(tag_ptr, seg);
+    unsigned int tag = tag_ptr - list->t_arr;
+
+    // attaching the segment created after fork
+    if (PT_SegMap[tag][seg] == NULL) {
+        char name[PT_SEG_NAME_SIZE];
+        PT_SegName(list, tag, seg, name);
+        size_t size = PT_SegSize(tag_ptr, seg) * sizeof(struct PTProcess);
+
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd == -1) {
+            return NULL;
+        }
+        PTProcessPtr seg_ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (seg_ptr == MAP_FAILED) {
+            return NULL;
+        }
+        PT_SegMap[tag][seg] = seg_ptr;
+    }
+
+    return &(PT_SegMap[tag][seg][offset]);
+}
+
+/**
+ * Pushes slot of a dead process to the free-list of the tag. The free-list is lock-free, so it can be used
+ * by the SIGCHLD handler while the init process is creating a process.
+ * 
+ * @param list Pointer to PTList.
+ * @param tag_ptr Pointer to the tag.
+ * @param slot Index of the slot in the process array of the tag.
+ */
+static void PT_SlotPush(PTList *list, PTListTagPtr tag_ptr, int slot)
+{
+    PTProcessPtr process_ptr = PT_Slot(list, tag_ptr, slot);
+    uint64_t head = __atomic_load_n(&(tag_ptr->free_head), __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    do {
+        __atomic_store_n(&(process_ptr->next_free), (int)(uint32_t)head - 1, __ATOMIC_RELAXED);
+        new_head = (((head >> 32) + 1) << 32) | (uint32_t)(slot + 1);
+    } while (!__atomic_compare_exchange_n(&(tag_ptr->free_head), &head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Pops slot of a dead process from the free-list of the tag.
+ * 
+ * @param list Pointer to PTList.
+ * @param tag_ptr Pointer to the tag.
+ * @return int Returns index of the slot, or (-1) if there are no dead processes in the tag.
+ */
+static int PT_SlotPop(PTList *list, PTListTagPtr tag_ptr)
+{
+    uint64_t head = __atomic_load_n(&(tag_ptr->free_head), __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    int slot;
+    do {
+        slot = (int)(uint32_t)head - 1;
+        if (slot == -1) {
+            return -1;
+        }
+        int next = __atomic_load_n(&(PT_Slot(list, tag_ptr, slot)->next_free), __ATOMIC_RELAXED);
+        new_head = (((head >> 32) + 1) << 32) | (uint32_t)(next + 1);
+    } while (!__atomic_compare_exchange_n(&(tag_ptr->free_head), &head, new_head, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return slot;
+}
+
+/**
+ * SIGCHLD handler of the init process, reaps terminated children of the table and marks them dead. Only pids in
+ * the pid index are waited for, so other children of the program are left to their owner.
+ * 
+ * @param sig Number of the signal.
+ */
+static void PT_SigChld(int sig)
+{
+    (void)sig;
+    int saved_errno = errno;
+    for (size_t i = 0; PT_ReapList != NULL && i < PT_PidCap; i++) {
+        // reaped entry is replaced by the next one of it's cluster, so the same entry is checked again
+        while (PT_PidMap[i].pid != 0 && waitpid(PT_PidMap[i].pid, NULL, WNOHANG) > 0) {
+            PT_ProcessReap(PT_ReapList, PT_PidMap[i].pid);
+        }
+    }
+    errno = saved_errno;
+}
+
+/**
+ * Function creates (PTList) with the same capacity of every tag, see PT_InitCapacity().
+ * 
+ * @param t_size Number of tag nodes which will be created (at most PT_TAG_MAX)
+ * @param p_size Number of process data nodes which will be created in every tag, tags grow when they are full
+ * @return Pointer to PTList if successful or NULL pointer if not
+ */
+extern PTList* PT_Init(size_t t_size, size_t p_size) 
+{
+    size_t p_sizes[PT_TAG_MAX];
+    for (unsigned int i = 0; i < t_size && i < PT_TAG_MAX; i++) {
+        p_sizes[i] = p_size;
+    }
+    return PT_InitCapacity(t_size, NULL, p_sizes);
+}
+
 /**
  * Function creates (PTList), which is an list with processes and it's data. PTList is a struct with array of tags where, 
  * each tag contains an array of process data nodes which can contain data about the processes. PTList also contains shared data
  * of which used by the other functions. Shared data is a data module specifically created for this project.
+ * Every tag has it's own capacity, so tags with few processes don't reserve memory for the biggest one.
  * 
- * @param list Pointer to PTlist
- * @param t_size Number of tag nodes which will be created
- * @param p_size Number of process data nodes which will be created
+ * @param t_size Number of tag nodes which will be created (at most PT_TAG_MAX)
+ * @param keys Keys of the tags, or NULL if tags get the capacities in order in which they are created
+ * @param p_sizes Number of process data nodes which will be created in every tag, tags grow when they are full
  * @return Pointer to PTList if successful or NULL pointer if not
  */
-extern PTList* PT_Init(size_t t_size, size_t p_size) 
+extern PTList* PT_InitCapacity(size_t t_size, char *keys[], const size_t p_sizes[])
+{
+    return PT_InitNamed(t_size, keys, p_sizes, NULL);
+}
+
+/**
+ * Releases the parts of (PTList) which PT_InitNamed() created before it failed.
+ * 
+ * @param list Pointer to PTList, it's parts which weren't created are NULL
+ * @param t_size Number of tag nodes of the list
+ * @param p_sizes Number of process data nodes of every tag
+ * @param p_num Number of tags whose process data nodes were created
+ * @param name Name of the shared memory created for the list data, or NULL if there is none
+ * @return PTList* Always NULL
+ */
+static PTList* PT_InitUndo(PTList *list, size_t t_size, const size_t p_sizes[], size_t p_num, const char *name)
+{
+    if (list->t_arr != NULL) {
+        for (size_t i = 0; i < p_num; i++) {
+            munmap(list->t_arr[i].p_arr, p_sizes[i] * sizeof(struct PTProcess));
+        }
+        munmap(list->t_arr, t_size * sizeof(struct PTListTag));
+    }
+    if (list->shared_data != NULL) {
+        munmap(list->shared_data, sizeof(struct PTListData));
+    }
+    if (name != NULL) {
+        shm_unlink(name);
+    }
+    munmap(list, sizeof(PTList));
+    return NULL;
+}
+
+/**
+ * Function creates (PTList) like PT_InitCapacity(), but the shared data are in named shared memory, so programs
+ * which weren't forked from the init process can attach them (see SM_OfficeAttach()).
+ * 
+ * @param t_size Number of tag nodes which will be created (at most PT_TAG_MAX)
+ * @param keys Keys of the tags, or NULL if tags get the capacities in order in which they are created
+ * @param p_sizes Number of process data nodes which will be created in every tag, tags grow when they are full
+ * @param name Name of the shared memory ("/name"), or NULL if the shared data are anonymous
+ * @return Pointer to PTList if successful or NULL pointer if not
+ */
+extern PTList* PT_InitNamed(size_t t_size, char *keys[], const size_t p_sizes[], const char *name)
 {      
+    if (name != NULL && (name[0] != '/' || strlen(name) >= PT_SEG_NAME_SIZE - 8)) {
+        DS_ERROR("ERROR - PT_Init, wrong name of the shared memory\n");  
+        return NULL;
+    }
+
+    // process local segment map has fixed number of tags
+    if (t_size > PT_TAG_MAX) {
+        DS_ERROR("ERROR - PT_Init, wrong size of the table\n");  
+        return NULL;
+    }
+    for (unsigned int i = 0; i < t_size; i++) {
+        if (p_sizes[i] == 0 || (keys != NULL && strlen(keys[i]) >= KEY_MAX_SIZE)) {
+            DS_ERROR("ERROR - PT_Init, wrong size of the table\n");  
+            return NULL;
+        }
+    }
+
     // creating list struct
     PTList* list = mmap(NULL, sizeof(PTList), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-    if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_Init, mmap failed (PTList)\n");  
+    if (list == MAP_FAILED) {
+        DS_ERROR("ERROR - PT_Init, mmap failed (PTList)\n");  
         return NULL;
     }
 
-    // creating the list data
-    list->shared_data = mmap(NULL, sizeof(struct PTListData), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-    if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_Init, mmap failed (PTListDat)\n");  
-        return NULL;
+    // creating the list data, named shared memory can be attached by other programs, it's removed if the list
+    // isn't created, so the name can be used again
+    PTListDataPtr shared_data;
+    if (name == NULL) {
+        shared_data = mmap(NULL, sizeof(struct PTListData), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    } else {
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd == -1) {
+            DS_ERROR("ERROR - PT_Init, shm_open failed (%s)\n", name);  
+            return PT_InitUndo(list, t_size, p_sizes, 0, NULL);
+        }
+        if (ftruncate(fd, sizeof(struct PTListData)) == -1) {
+            DS_ERROR("ERROR - PT_Init, ftruncate failed (%s)\n", name);  
+            close(fd);
+            return PT_InitUndo(list, t_size, p_sizes, 0, name);
+        }
+        shared_data = mmap(NULL, sizeof(struct PTListData), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+    if (shared_data == MAP_FAILED) {
+        DS_ERROR("ERROR - PT_Init, mmap failed (PTListDat)\n");  
+        return PT_InitUndo(list, t_size, p_sizes, 0, name);
+    }
+    list->shared_data = shared_data;
+    if (name != NULL) {
+        strcpy(list->shared_data->name, name);
     }
 
     // creating array tags
-    list->t_arr = mmap(NULL, t_size * sizeof(struct PTListTag), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-    if (list->t_arr == NULL) {
-        fprintf(stderr, "ERROR - PT_Init, mmap failed (PTListTag)\n");  
-        return NULL;
+    PTListTagPtr t_arr = mmap(NULL, t_size * sizeof(struct PTListTag), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (t_arr == MAP_FAILED) {
+        DS_ERROR("ERROR - PT_Init, mmap failed (PTListTag)\n");  
+        return PT_InitUndo(list, t_size, p_sizes, 0, name);
     }
+    list->t_arr = t_arr;
 
     // creating process nodes
+    list->p_size = 0;
     for (unsigned int i = 0; i < t_size; i++) {
-        list->t_arr[i].p_arr = mmap(NULL, p_size * sizeof(struct PTProcess), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-        if (list->t_arr[i].p_arr == NULL) {
-            fprintf(stderr, "ERROR - PT_Init, mmap failed (PTProcess)\n");  
-            return NULL;
+        list->t_arr[i].p_arr = mmap(NULL, p_sizes[i] * sizeof(struct PTProcess), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (list->t_arr[i].p_arr == MAP_FAILED) {
+            DS_ERROR("ERROR - PT_Init, mmap failed (PTProcess)\n");  
+            return PT_InitUndo(list, t_size, p_sizes, i, name);
+        }
+        list->t_arr[i].p_base = p_sizes[i];
+        list->t_arr[i].seg_num = 1;
+        list->t_arr[i].p_cap = p_sizes[i];
+        list->p_size = MAX(list->p_size, p_sizes[i]);
+
+        // tags with given keys exist from the start
+        if (keys != NULL) {
+            strcpy(list->t_arr[i].key, keys[i]);
         }
     }
 
     // adding data of the process table
-    list->p_size = p_size;
     list->t_size = t_size;
-    list->t_num = 0;
+    list->t_num = (keys != NULL) ? t_size : 0;
 
     // adding data of the intialization process
     list->init_pid.pid = getpid();
     list->init_pid.ppid = getppid();
     list->init_pid.state = RUNNING;
 
+    // terminated children are reaped as soon as they end, so their slots can be reused, handler of the program
+    // is saved and PT_Destroy() puts it back
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = PT_SigChld;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&(sa.sa_mask));
+    if (sigaction(SIGCHLD, &sa, (PT_ReapList == NULL) ? &PT_OldSigChld : NULL) == -1) {
+        DS_ERROR("ERROR - PT_Init, sigaction failed\n");
+        return PT_InitUndo(list, t_size, p_sizes, t_size, name);
+    }
+    PT_ReapList = list;
+
     return list;
 }
 
@@ -76,7 +491,7 @@ extern int PT_Destroy(PTList **list)
 {
     // checking if list is empty
     if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_Destroy, list is empty\n");
+        DS_ERROR("ERROR - PT_Destroy, list is empty\n");
         return 1;
     }
 
@@ -85,10 +500,35 @@ extern int PT_Destroy(PTList **list)
         return 0;
     }
 
+    // restoring SIGCHLD handler of the program
+    if (PT_ReapList == *list) {
+        sigaction(SIGCHLD, &PT_OldSigChld, NULL);
+        PT_ReapList = NULL;
+    }
+    if (PT_PidMap != NULL) {
+        munmap(PT_PidMap, PT_PidCap * sizeof(PTPidEntry));
+        PT_PidMap = NULL;
+        PT_PidCap = PT_PidNum = 0;
+    }
+
     // deallocating all the shared memory
     int err_val = 0;
-    err_val += munmap((*list)->t_arr->p_arr, (*list)->p_size * sizeof(struct PTListData));
+    for (unsigned int i = 0; i < (*list)->t_size; i++) {
+        err_val += munmap((*list)->t_arr[i].p_arr, (*list)->t_arr[i].p_base * sizeof(struct PTProcess));
+
+        // named segments of grown tags
+        for (unsigned int j = 1; j < (*list)->t_arr[i].seg_num; j++) {
+            char name[PT_SEG_NAME_SIZE];
+            PT_SegName(*list, i, j, name);
+            err_val += munmap(PT_SegMap[i][j], PT_SegSize(&((*list)->t_arr[i]), j) * sizeof(struct PTProcess));
+            err_val += shm_unlink(name);
+            PT_SegMap[i][j] = NULL;
+        }
+    }
     err_val += munmap((*list)->t_arr, (*list)->t_size * sizeof(struct PTListTag));
+    if ((*list)->shared_data->name[0] != '\0') {
+        err_val += shm_unlink((*list)->shared_data->name);
+    }
     err_val += munmap((*list)->shared_data, sizeof(struct PTListData));
     err_val += munmap(*list, sizeof(PTList));
 
@@ -97,13 +537,33 @@ extern int PT_Destroy(PTList **list)
     
     // error handling
     if (err_val != 0) {
-        fprintf(stderr, "ERROR - PT_Destroy, munmap failed\n");
+        DS_ERROR("ERROR - PT_Destroy, munmap failed\n");
         return 1;
     }
 
     return 0;
 }
 
+/**
+ * Returns number of bytes of shared memory used by the process table, including grown segments of the tags
+ * and the shared data (memory allocated by the shared data modules isn't included).
+ * 
+ * @param list Pointer to PTlist
+ * @return size_t Number of bytes
+ */
+extern size_t PT_Footprint(PTList *list)
+{
+    if (list == NULL) {
+        return 0;
+    }
+
+    size_t size = sizeof(PTList) + sizeof(struct PTListData) + list->t_size * sizeof(struct PTListTag);
+    for (unsigned int i = 0; i < list->t_size; i++) {
+        size += __atomic_load_n(&(list->t_arr[i].p_cap), __ATOMIC_ACQUIRE) * sizeof(struct PTProcess);
+    }
+    return size;
+}
+
 /**
  * Function checks if the process which passes the function is the process which is saved in the PTList under the given tag.
  * 
@@ -115,7 +575,7 @@ extern int PT_IsTag(PTList *list, char *tag) {
 
     // checking if list is empty
     if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_IsTag, list is empty\n");
+        DS_ERROR("ERROR - PT_IsTag, list is empty\n");
         return 0;
     }
     
@@ -128,7 +588,7 @@ extern int PT_IsTag(PTList *list, char *tag) {
             
             // search for process in the tag
             for (unsigned int j = 0; j < list->t_arr[i].p_num; j++) {
-                if (list->t_arr[i].p_arr[j].pid == searched_pid) {
+                if (PT_Slot(list, &(list->t_arr[i]), j)->pid == searched_pid) {
                     return 1;
                 }
             }
@@ -150,15 +610,8 @@ extern int PT_IsTag(PTList *list, char *tag) {
  */
 extern int PT_ProcessSearch(PTList *list, pid_t pid, char *tag, int *tag_num, int *pro_num)
 {
-    // checking if table is empty
-    if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_ProcessSearch, list is empty\n");
-        return 0;
-    }
-
-    // check if the given pointers are not NULL
-    if (tag == NULL || tag_num == NULL || pro_num == NULL) {
-        fprintf(stderr, "ERROR - PT_ProcessSearch, one of given pointers is NULL\n");
+    // checking if table is empty and the given pointers are not NULL
+    if (list == NULL || tag == NULL || tag_num == NULL || pro_num == NULL) {
         return 0;
     }
 
@@ -166,7 +619,7 @@ extern int PT_ProcessSearch(PTList *list, pid_t pid, char *tag, int *tag_num, in
     for (unsigned int i = 0; i < list->t_num; i++) {          
         // search for process in the tag
         for (unsigned int j = 0; j < list->t_arr[i].p_num; j++) {
-            if (list->t_arr[i].p_arr[j].pid == pid) {
+            if (PT_Slot(list, &(list->t_arr[i]), j)->pid == pid) {
                 
                 // returning data
                 tag = list->t_arr[i].key;
@@ -178,36 +631,31 @@ extern int PT_ProcessSearch(PTList *list, pid_t pid, char *tag, int *tag_num, in
     }        
     
     // process not found
-    fprintf(stderr, "ERROR - PT_ProcessSearch, process not found\n");
     return 0;
 }
 
 /**
- * Function which creates a new process and adds data about the process to the PTList.
+ * Function which creates a new process and adds data about the process to the PTList. Slots of dead processes
+ * (see PT_ProcessReap()) are reused.
  * 
  * @param list Pointer to PTList
  * @param tag Tag of the process which will be assigned to the new created process
+ * @return pid_t Returns(0) in the new process, pid of the new process in the init process, or negative PTStatus 
+ *               if the process wasn't created (PT_ERR_ARG, PT_ERR_FULL, PT_ERR_SYS), nothing is printed
  */
-extern void PT_ProcessCreate(PTList *list, char *tag)
+extern pid_t PT_ProcessCreate(PTList *list, char *tag)
 {   
-    // checking if list is empty
-    if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_ProcessCreate, list is empty\n");
-        return;
-    }
-
-    // checking if process is the list proceess
-    if (getpid() != list->init_pid.pid) {
-        return;
+    // checking if list is empty and if process is the list proceess
+    if (list == NULL || getpid() != list->init_pid.pid) {
+        return PT_ERR_ARG;
     }
 
     // pointer data
     PTListTagPtr tag_ptr = NULL;
     PTProcessPtr process_ptr = NULL;
-    bool dead_process = false;
 
     // searching for tag
-    for (unsigned int i = 0; i < list->t_size; i++) {
+    for (unsigned int i = 0; i < list->t_num; i++) {
         if ((strcmp(list->t_arr[i].key, tag) == 0)) {
             tag_ptr = &(list->t_arr[i]);
             break;
@@ -219,94 +667,228 @@ extern void PT_ProcessCreate(PTList *list, char *tag)
         
         // list doesn't have any space for new tags
         if (list->t_num == list->t_size) {
-            fprintf(stderr, "ERROR - PT_ProcessCreate, there is no free space for new tags (list is full)\n");
-            return;
+            return PT_ERR_FULL;
         }
 
         // add data to new tag
         tag_ptr = &(list->t_arr[list->t_num]);
-        list->t_num++;
         strcpy(tag_ptr->key, tag);
-        process_ptr = &(tag_ptr->p_arr[0]);
-        
-    // if tag exist's, add it to existing tag
-    } else {
-        // rewriting existing tag
-        if (tag_ptr->p_num == 0) {
-            strcpy(tag_ptr->key, tag);
-            process_ptr = &(tag_ptr->p_arr[0]);
-        
-        // searching for free space in tag
-        } else {
-
-            // searching for free space in tag
-            for (unsigned int i = 0; i < tag_ptr->p_num; i++) {
-                if (tag_ptr->p_arr[i].state == 0) {
-                    process_ptr = &(tag_ptr->p_arr[i]);
-                    dead_process = true;
-                }
-            }
+        tag_ptr->free_head = 0;
+        list->t_num++;
+    }
 
-            // if there is no free space in tag, create new process
-            if (dead_process == false) {
-                if (tag_ptr->p_num == list->p_size) {
-                    fprintf(stderr, "ERROR - PT_ProcessCreate, there is no free space for processes (tag is full)\n");
-                    return;
-                } else {
-                    process_ptr = &(tag_ptr->p_arr[tag_ptr->p_num]);
-                }
-            }
+    // slot of a dead process is reused, otherwise a new slot is taken from the end of the tag
+    int slot = PT_SlotPop(list, tag_ptr);
+    if (slot == -1) {
+        if (tag_ptr->p_num == tag_ptr->p_cap && PT_SegGrow(list, tag_ptr) != 0) {
+            return PT_ERR_FULL;
         }
+        slot = tag_ptr->p_num;
+        __atomic_store_n(&(tag_ptr->p_num), tag_ptr->p_num + 1, __ATOMIC_RELEASE);
     }
+    process_ptr = PT_Slot(list, tag_ptr, slot);
 
     // creating new process and adding the apropiate data
-    tag_ptr->p_num++;
-    tag_ptr->p_run++;
+    __atomic_add_fetch(&(tag_ptr->p_run), 1, __ATOMIC_RELAXED);
     process_ptr->state = RUNNING;
-
-    pid_t pid = fork();
-
-    if (pid == 0) {
+    process_ptr->pid = 0;
+
+    // SIGCHLD is blocked until the pid is written, otherwise the handler couldn't find a process which ended quickly
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &old);
+
+    // index of children has to have room before the child exists
+    pid_t pid = (PT_PidReserve() == 0) ? fork() : -1;
+
+    if (pid == -1) {
+        pid = PT_ERR_SYS;
+        __atomic_sub_fetch(&(tag_ptr->p_run), 1, __ATOMIC_RELAXED);
+        process_ptr->state = DEAD;
+        PT_SlotPush(list, tag_ptr, slot);
+    } else if (pid == 0) {
         process_ptr->pid = getpid();
         process_ptr->ppid = getppid();
+        PT_Self = process_ptr;
+        PT_SelfTag = tag_ptr;
+        PT_SelfSlot = slot;
+    } else {
+        // parent writes the pid too, so the process can be reaped before it runs
+        process_ptr->pid = pid;
+        process_ptr->ppid = getpid();
+        PT_PidInsert(pid, (unsigned int)(tag_ptr - list->t_arr), (unsigned int)slot);
     }
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return pid;
 }
 
 /**
- * Process will print all the data in the PTlist. Used for debugging.
+ * Marks process which was reaped by wait() as dead and adds it's slot to the free-list of the tag, so PT_ProcessCreate()
+ * can reuse it. The slot is found in the pid index of the init process in O(1). Function is async-signal-safe, 
+ * it is called by the SIGCHLD handler.
  * 
- * @param list Pointer to PTList.
+ * @param list Pointer to PTList
+ * @param pid Process ID of the reaped process
+ * @return int Returns(0) if the process was marked, returns(-1) if it isn't in the list.
  */
-extern void PT_PrintList(PTList *list)
-{   
-    if (list->init_pid.pid != getpid()) {
-        return;
+extern int PT_ProcessReap(PTList *list, pid_t pid)
+{
+    // checking if list is empty and if the process is it's child
+    PTPidEntry entry;
+    if (list == NULL || PT_PidRemove(pid, &entry) != 0 || entry.tag >= list->t_num) {
+        return -1;
     }
 
-    if (list == NULL) {
-        fprintf(stderr, "ERROR - PT_PrintList, list is empty\n");
-        return;
+    PTListTagPtr tag_ptr = &(list->t_arr[entry.tag]);
+    PTProcessPtr process_ptr = PT_Slot(list, tag_ptr, entry.slot);
+    if (process_ptr == NULL || process_ptr->pid != pid || process_ptr->state == DEAD) {
+        return -1;
     }
 
-    // printing list data
-    printf(" t_size: %ld, p_size: %ld, init_pid: %d\n", list->t_size, list->p_size, list->init_pid.pid);
+    // process could end while being asleep (killed)
+    if (process_ptr->state == SLEEPING) {
+        __atomic_sub_fetch(&(tag_ptr->p_sleep), 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_sub_fetch(&(tag_ptr->p_run), 1, __ATOMIC_RELAXED);
+    }
+    process_ptr->state = DEAD;
+    PT_SlotPush(list, tag_ptr, entry.slot);
+    return 0;
+}
 
-    // going through every tag
-    for (unsigned int i = 0; i < list->t_num; i++) {
+/**
+ * Waits for all child processes of the table and reaps them, other children of the init process aren't waited for.
+ * SIGCHLD is blocked meanwhile, so children aren't reaped by the handler.
+ * 
+ * @param list Pointer to PTList
+ * @return int Returns(0) if all the processes were reaped, returns(-1) if wait failed.
+ */
+extern int PT_ProcessWaitAll(PTList *list)
+{
+    // checking if process is the list proceess
+    if (list == NULL || getpid() != list->init_pid.pid) {
+        return 0;
+    }
 
-        // printing tag
-        printf("( %s ) ->", list->t_arr[i].key);
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &old);
 
-        // going through every process in tag
-        for (unsigned int j = 0; j < list->t_arr[i].p_num; j++) {
-            printf("[ %d, %d, %d ]; ", list->t_arr[i].p_arr[j].pid, 
-            list->t_arr[i].p_arr[j].ppid, list->t_arr[i].p_arr[j].state);
+    // reaped entry is replaced by the next one of it's cluster, so the entries are walked once
+    int err_val = 0;
+    for (size_t i = 0; i < PT_PidCap && err_val == 0; i++) {
+        while (PT_PidMap[i].pid != 0) {
+            pid_t pid = PT_PidMap[i].pid;
+            if (waitpid(pid, NULL, 0) == -1 && errno != ECHILD) {
+                if (errno != EINTR) {
+                    err_val = -1;
+                    break;
+                }
+                continue;
+            }
+            PT_ProcessReap(list, pid);
         }
-        printf("\n");
     }
-    printf(" - - - - - - -\n");
-}
-
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return err_val;
+}
+
+/**
+ * Returns number of living (running and sleeping) processes in the tag. Processes which ended are counted until
+ * they are reaped.
+ * 
+ * @param list Pointer to PTList
+ * @param tag Tag of the processes
+ * @return unsigned int Number of processes, (0) if the tag doesn't exist
+ */
+extern unsigned int PT_ProcessCount(PTList *list, char *tag)
+{
+    if (list == NULL) {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < list->t_num; i++) {
+        if (strcmp(list->t_arr[i].key, tag) == 0) {
+            return __atomic_load_n(&(list->t_arr[i].p_run), __ATOMIC_RELAXED) 
+                 + __atomic_load_n(&(list->t_arr[i].p_sleep), __ATOMIC_RELAXED);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Returns slot of the calling process in it's tag, slots of dead processes are reused, so the slot can be
+ * used as an index of per-process records of processes which live at the same time.
+ * 
+ * @return int Slot of the process, (-1) in the init process
+ */
+extern int PT_ProcessSlot(void)
+{
+    return PT_SelfSlot;
+}
+
+/**
+ * Marks the calling process as sleeping or running, so p_sleep and p_run of it's tag are accurate. Used by the sleep
+ * functions and around blocking semaphores, does nothing in the init process.
+ * 
+ * @param sleeping true if the process goes to sleep, false if it woke up
+ */
+extern void PT_ProcessSleep(bool sleeping)
+{
+    if (PT_Self == NULL || (PT_Self->state == SLEEPING) == sleeping) {
+        return;
+    }
+
+    if (sleeping) {
+        __atomic_add_fetch(&(PT_SelfTag->p_sleep), 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&(PT_SelfTag->p_run), 1, __ATOMIC_RELAXED);
+        PT_Self->state = SLEEPING;
+    } else {
+        PT_Self->state = RUNNING;
+        __atomic_add_fetch(&(PT_SelfTag->p_run), 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&(PT_SelfTag->p_sleep), 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Process will print all the data in the PTlist. Used for debugging.
+ * 
+ * @param list Pointer to PTList.
+ */
+extern void PT_PrintList(PTList *list)
+{   
+    if (list->init_pid.pid != getpid()) {
+        return;
+    }
+
+    if (list == NULL) {
+        DS_ERROR("ERROR - PT_PrintList, list is empty\n");
+        return;
+    }
+
+    // printing list data
+    printf(" t_size: %ld, p_size: %ld, init_pid: %d\n", list->t_size, list->p_size, list->init_pid.pid);
+
+    // going through every tag
+    for (unsigned int i = 0; i < list->t_num; i++) {
+
+        // printing tag
+        printf("( %s ) ->", list->t_arr[i].key);
+
+        // going through every process in tag
+        for (unsigned int j = 0; j < list->t_arr[i].p_num; j++) {
+            PTProcessPtr process_ptr = PT_Slot(list, &(list->t_arr[i]), j);
+            printf("[ %d, %d, %d ]; ", process_ptr->pid, process_ptr->ppid, process_ptr->state);
+        }
+        printf("\n");
+    }
+    printf(" - - - - - - -\n");
+}
+
 
 
 /* - - - - - - - - - - - */
@@ -315,82 +897,1828 @@ extern void PT_PrintList(PTList *list)
 // Shared memory - functions which use counter data
 // These functions are used by main() and office functions
 
+/* every printed event is recorded into the timeline (see SM_TIMELINE) */
+static void SM_TimelineEvent(PTListDataPtr shared_data, EVEvent event, int id, int arg, uint64_t now);
+
+/* time of officers is split by their events (see SM_METRICS) */
+static void SM_MetricsOfficer(PTListDataPtr shared_data, EVEvent event, int id);
+
+/* Timestamp file of the calling process (process local), inherited by fork and opened by external clients, 
+ * (-1) if lines aren't timestamped */
+static int SM_TsFd = -1;
+
+/* Log ring mapped by the calling process (process local) and it's writer thread (init process), NULL if lines 
+ * are printed into the log file right away */
+static LWRing *SM_LogRing = NULL;
+static LWWriter SM_LogWriter;
+
+/* Pre-sized log file opened for mapping by the calling process and it's mapping (process local), it's remapped 
+ * when another process grows the file, NULL if the log isn't mapped or the process didn't print a line yet */
+static int SM_LogMapFd = -1;
+static char *SM_LogMap = NULL;
+static size_t SM_LogMapLen = 0;
+
+/* parts of the office in their own shared memory (see SM_OFFICE) */
+static void *SM_SharedMap(PTListDataPtr shared_data, const char *suffix, size_t size, bool create);
+static int SM_SharedUnmap(PTListDataPtr shared_data, const char *suffix, void *ptr, size_t size, bool unlink);
+
+/**
+ * Writes timestamp of a line into the timestamp file, timestamp of line n is at offset (n - 1) * 8. Lines are
+ * numbered under the semaphore, so the timestamp can be written after it's released.
+ * 
+ * @param seq Number of the line.
+ * @param now Time taken under the semaphore (nsec_now()).
+ * @return int returns(0) if the timestamp was written, PT_ERR_SYS if not.
+ */
+static int SM_CounterStamp(unsigned int seq, uint64_t now)
+{
+    ssize_t ret;
+    while ((ret = pwrite(SM_TsFd, &now, sizeof(now), (off_t)(seq - 1) * sizeof(now))) == -1 && errno == EINTR);
+    return (ret == sizeof(now)) ? 0 : PT_ERR_SYS;
+}
+
+/**
+ * Reserves size bytes of the log file, the space is allocated, so copying lines into the mapping doesn't fail
+ * on a full disk. File systems without fallocate() get a sparse file.
+ * 
+ * @param fd Log file.
+ * @param size New size of the file.
+ * @return int returns(0) if the file has the size, (-1) if not.
+ */
+static int SM_CounterReserve(int fd, uint64_t size)
+{
+    int ret = posix_fallocate(fd, 0, (off_t)size);
+    if (ret == EINVAL || ret == EOPNOTSUPP) {
+        return ftruncate(fd, (off_t)size);
+    }
+    return (ret == 0) ? 0 : -1;
+}
+
+/**
+ * Copies bytes into the mapped log at the reserved offset, the file is grown (twice the size) when the reservation 
+ * is used up and the process maps it again when another process grew it. Must be called under the counter semaphore.
+ * 
+ * @param cnt Counter.
+ * @param fd Log file opened for mapping.
+ * @param data Bytes of the line or record.
+ * @param len Number of bytes.
+ * @return int returns(0) if the bytes were copied, PT_ERR_SYS if not.
+ */
+static int SM_CounterMapAppend(SM_Counter *cnt, int fd, const void *data, size_t len)
+{
+    // [0] - grow the reservation
+    uint64_t end = cnt->map_used + len;
+    if (end > cnt->map_size) {
+        uint64_t size = MAX(end, cnt->map_size * 2);
+        if (SM_CounterReserve(fd, size) != 0) {
+            return PT_ERR_SYS;
+        }
+        cnt->map_size = size;
+    }
+
+    // [1] - mapping of this process has to cover the whole reservation
+    if (SM_LogMapLen < cnt->map_size) {
+        if (SM_LogMap != NULL) {
+            munmap(SM_LogMap, SM_LogMapLen);
+        }
+        SM_LogMap = mmap(NULL, cnt->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (SM_LogMap == MAP_FAILED) {
+            SM_LogMap = NULL;
+            SM_LogMapLen = 0;
+            return PT_ERR_SYS;
+        }
+        SM_LogMapLen = cnt->map_size;
+    }
+
+    // [2] - copy, page fault every page instead of a system call every line
+    memcpy(SM_LogMap + cnt->map_used, data, len);
+    cnt->map_used = end;
+    return 0;
+}
+
+/**
+ * Writes a line or record into the log, where it goes depends on the mode of the counter - mapped file, log ring
+ * of the writer thread or the log file. Must be called under the counter semaphore.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param file Log file of the calling process.
+ * @param data Bytes of the line or record.
+ * @param len Number of bytes.
+ * @return int returns(0) if the bytes were written, PT_ERR_SYS if not.
+ */
+static int SM_CounterAppend(PTListDataPtr shared_data, FILE *file, const void *data, size_t len)
+{
+    if (SM_LogMapFd != -1) {
+        return SM_CounterMapAppend(&(shared_data->cnt), SM_LogMapFd, data, len);
+    }
+    if (SM_LogRing != NULL) {
+        LW_RingAppend(SM_LogRing, data, len);
+        return 0;
+    }
+    fwrite(data, 1, len, file);
+    return (fflush(file) == 0) ? 0 : PT_ERR_SYS;
+}
+
 /**
  * Initializes counter data and semaphores. This function must be called before using any other function.
  * Also, this function must be called before creating new processes, memory is allocated through mmap().
  * 
  * @param shared_data Pointer to shared_data.
- * @return int returns(0) if the function intiliazes corectly, returns(-1) if the initiliazation fails.
+ * @return int returns(0) if the function intiliazes corectly, returns(-1) if the initiliazation fails.
+ */
+int SM_CounterInit(PTListDataPtr shared_data)
+{
+    // semaphore is already initialised 
+    if (shared_data->cnt.sem_state == SEM_INIT) {
+        DS_ERROR("ERROR - SM_CounterInit, semaphore is already initialised\n");
+        return -1;
+    }
+    
+    // initialising counter data
+    shared_data->cnt.sem_state = SEM_INIT;
+    shared_data->cnt.data = 1;
+    shared_data->cnt.format = EV_FORMAT_TEXT;
+    shared_data->cnt.ts_path[0] = '\0';
+    shared_data->cnt.ring = false;
+    shared_data->cnt.map = false;
+
+    // initialising semaphore 1
+    if (sem_init(&(shared_data->cnt.sem_1), 1, 1) == -1) {
+        DS_ERROR("ERROR - SM_CounterInit, sem_init failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Function which prints message with counter data and increments the counter.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param file Pointer to file where the data will be printed
+ * @param message Message which will be printed with counter data in the format: "counter: message"
+ * @return int returns(0) if the message was printed, returns PT_ERR_SYS if the semaphore failed (nothing is printed to stderr).
+ */
+int SM_CounterPrint(PTListDataPtr shared_data, FILE *file, char *message)
+{
+    // [0] - SEM-WAIT
+    // init process can be interrupted by SIGCHLD
+    int res;
+    while ((res = sem_wait(&(shared_data->cnt.sem_1))) == -1 && errno == EINTR);
+    if (res == -1) {
+        return PT_ERR_SYS;
+    }
+
+    // [1] - PRINT
+    // print message and increment counter, the line is timestamped while it's number is taken
+    unsigned int seq = shared_data->cnt.data++;
+    uint64_t now = (SM_TsFd != -1) ? nsec_now() : 0;
+    char line[BUFFER_SIZE + 16];
+    int len = snprintf(line, sizeof(line), "%u: %s\n", seq, message);
+    int ret = SM_CounterAppend(shared_data, file, line, MIN((size_t)len, sizeof(line) - 1));
+
+    // [2] - SEMPOST
+    if (sem_post(&(shared_data->cnt.sem_1)) == -1) {
+        return PT_ERR_SYS;
+    }
+    if (SM_LogRing != NULL) {
+        LW_RingWake(SM_LogRing);
+    }
+
+    if (ret == 0 && SM_TsFd != -1) {
+        ret = SM_CounterStamp(seq, now);
+    }
+    return ret;
+}
+
+/**
+ * Sets format of the log, all processes print their events in it. This function must be called before creating
+ * new processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param format Name of the format ("text" - lines of the assignment, "binary" - records EVRecord).
+ * @return int return(0) if the format is set, returns(-1) if the format is unknown.
+ */
+int SM_CounterSetFormat(PTListDataPtr shared_data, const char *format)
+{
+    int value = EV_FormatParse(format);
+    if (value < 0) {
+        DS_ERROR("ERROR - SM_CounterSetFormat, unknown format of the log %s\n", format);
+        return -1;
+    }
+    shared_data->cnt.format = (EVFormat)value;
+    return 0;
+}
+
+/**
+ * Function which prints an event with counter data and increments the counter. Text log gets the line 
+ * "counter: message", message is built from the template of the event before the semaphore is taken and only 
+ * the digits of the counter are written in front of it under the semaphore (no format strings, no copies). 
+ * Binary log gets a record which is filled in advance too, only the counter is set under the semaphore.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param file Pointer to file where the event will be printed.
+ * @param event Event which is printed.
+ * @param id Number of the customer or officer.
+ * @param arg Argument of the event (type of the service), (0) if it has none.
+ * @return int returns(0) if the event was printed, returns PT_ERR_SYS if the semaphore failed, PT_ERR_ARG if
+ *             the event is unknown (nothing is printed to stderr).
+ */
+int SM_CounterEvent(PTListDataPtr shared_data, FILE *file, EVEvent event, int id, int arg)
+{
+    // [0] - prepare the line or record
+    EVLine line;
+    EVRecord record;
+    bool binary = (shared_data->cnt.format == EV_FORMAT_BINARY);
+    if (binary) {
+        EV_RecordFill(&record, event, id, arg);
+    } else if (EV_LinePrepare(&line, event, id, arg) < 0) {
+        return PT_ERR_ARG;
+    }
+
+    // [1] - SEM-WAIT
+    int res;
+    while ((res = sem_wait(&(shared_data->cnt.sem_1))) == -1 && errno == EINTR);
+    if (res == -1) {
+        return PT_ERR_SYS;
+    }
+
+    // [2] - PRINT
+    // the event is timestamped while it's number is taken, so timestamps follow the order of lines
+    unsigned int seq = shared_data->cnt.data++;
+    uint64_t now = (SM_TsFd != -1 || shared_data->timeline.enabled) ? nsec_now() : 0;
+    int ret;
+    if (binary) {
+        record.seq = seq;
+        ret = SM_CounterAppend(shared_data, file, &record, sizeof(record));
+    } else {
+        EV_LineNumber(&line, seq);
+        ret = SM_CounterAppend(shared_data, file, line.data + line.start, line.end - line.start);
+    }
+
+    // [3] - SEMPOST
+    if (sem_post(&(shared_data->cnt.sem_1)) == -1) {
+        return PT_ERR_SYS;
+    }
+    if (SM_LogRing != NULL) {
+        LW_RingWake(SM_LogRing);
+    }
+
+    if (shared_data->timeline.enabled) {
+        SM_TimelineEvent(shared_data, event, id, arg, now);
+    }
+    if (event >= EV_U_START && event <= EV_U_HOME) {
+        SM_MetricsOfficer(shared_data, event, id);
+    }
+    if (ret == 0 && SM_TsFd != -1) {
+        ret = SM_CounterStamp(seq, now);
+    }
+    return ret;
+}
+
+/**
+ * Turns on timestamps of lines. Monotonic time (nsec_now()) of every line is written into a side file as 
+ * a 64-bit integer (byte order of the machine) at offset (n - 1) * 8 for line n, so the log itself stays 
+ * the same. This function must be called before creating new processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param path Path of the timestamp file.
+ * @return int return(0) if the file was created, returns(-1) if not.
+ */
+int SM_CounterSetTimestamps(PTListDataPtr shared_data, const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || realpath(path, shared_data->cnt.ts_path) == NULL) {
+        DS_ERROR("ERROR - SM_CounterSetTimestamps, file %s can't be created\n", path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (SM_TsFd != -1) {
+        close(SM_TsFd);
+    }
+    SM_TsFd = fd;
+    return 0;
+}
+
+/**
+ * Lines go through a log ring in shared memory instead of the log file, a writer thread of the init process writes
+ * them into the file. Processes only copy lines into the ring under the counter semaphore, so the time the semaphore
+ * is held doesn't depend on the storage. This function must be called by the init process before creating new 
+ * processes, SM_CounterWriterStop() has to be called after they finish.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param file Log file, it's append flag is cleared, lines of external clients go through the ring too.
+ * @param spec Writer - "uring[,DEPTH]" (io_uring with DEPTH writes in flight, LW_DEPTH_DEFAULT by default, 
+ *             it falls back to pwrite if io_uring isn't available) or "pwrite".
+ * @return int return(0) if the writer runs, returns(-1) if not.
+ */
+int SM_CounterSetWriter(PTListDataPtr shared_data, FILE *file, const char *spec)
+{
+    // [0] - parse the writer
+    LWBackend backend;
+    int depth = LW_DEPTH_DEFAULT, len = 0;
+    if (strcmp(spec, "pwrite") == 0) {
+        backend = LW_BACKEND_PWRITE;
+    } else if (strcmp(spec, "uring") == 0 || (sscanf(spec, "uring,%d%n", &depth, &len) == 1 && spec[len] == '\0')) {
+        backend = LW_BACKEND_URING;
+    } else {
+        DS_ERROR("ERROR - SM_CounterSetWriter, unknown writer %s\n", spec);
+        return -1;
+    }
+    if (depth < 1 || depth > LW_DEPTH_MAX || SM_LogRing != NULL || shared_data->cnt.map) {
+        DS_ERROR("ERROR - SM_CounterSetWriter, wrong depth or the writer already runs\n");
+        return -1;
+    }
+
+    // [1] - ring and it's writer, nothing is left in the buffer of the file
+    fflush(file);
+    SM_LogRing = SM_SharedMap(shared_data, ".log", LW_RingBytes(LW_RING_SIZE), true);
+    if (SM_LogRing == MAP_FAILED || LW_RingInit(SM_LogRing, LW_RING_SIZE) != 0) {
+        DS_ERROR("ERROR - SM_CounterSetWriter, log ring can't be created\n");
+        SM_LogRing = NULL;
+        return -1;
+    }
+    if (LW_WriterStart(&SM_LogWriter, SM_LogRing, fileno(file), backend, depth) != 0) {
+        DS_ERROR("ERROR - SM_CounterSetWriter, writer can't be started\n");
+        LW_RingDestroy(SM_LogRing);
+        SM_SharedUnmap(shared_data, ".log", SM_LogRing, LW_RingBytes(LW_RING_SIZE), true);
+        SM_LogRing = NULL;
+        return -1;
+    }
+    shared_data->cnt.ring = true;
+    return 0;
+}
+
+/**
+ * Waits until the writer writes everything from the log ring, stops it and destroys the ring. Should be called 
+ * by the init process after all the processes finished.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param stats Pointer to file where statistics of the writer are printed, NULL if they aren't printed.
+ * @return int return(0) if the whole log was written, returns(-1) if not.
+ */
+int SM_CounterWriterStop(PTListDataPtr shared_data, FILE *stats)
+{
+    if (SM_LogRing == NULL) {
+        return 0;
+    }
+
+    int err_check = LW_WriterStop(&SM_LogWriter);
+    if (stats != NULL) {
+        LW_WriterPrint(&SM_LogWriter, stats);
+    }
+    err_check += LW_RingDestroy(SM_LogRing);
+    err_check += SM_SharedUnmap(shared_data, ".log", SM_LogRing, LW_RingBytes(LW_RING_SIZE), true);
+    SM_LogRing = NULL;
+    shared_data->cnt.ring = false;
+
+    if (err_check != 0) {
+        DS_ERROR("ERROR - SM_CounterWriterStop, log wasn't written\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Lines are copied straight into the log file mapped into memory, at the offset reserved under the counter semaphore.
+ * The file is allocated reserve bytes ahead, so there is no stdio buffer and no system call per line, only a page 
+ * fault per page. It grows when the reservation is used up. This function must be called by the init process before
+ * creating new processes, SM_CounterMapStop() truncates the file to it's real length after they finish. Processes
+ * don't need a stream of the log, the file is opened here and they inherit the mapping.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param path Path of the log file, it's created or truncated.
+ * @param reserve Number of bytes reserved for lines.
+ * @return int return(0) if the file is mapped, returns(-1) if not.
+ */
+int SM_CounterSetMap(PTListDataPtr shared_data, const char *path, size_t reserve)
+{
+    SM_Counter *cnt = &(shared_data->cnt);
+    if (reserve == 0 || cnt->ring || cnt->map) {
+        DS_ERROR("ERROR - SM_CounterSetMap, nothing to reserve or the log is already written by the writer\n");
+        return -1;
+    }
+
+    // [0] - shared mapping needs the file opened for reading too, external clients open it by it's absolute path
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1 || realpath(path, cnt->map_path) == NULL) {
+        DS_ERROR("ERROR - SM_CounterSetMap, log file %s can't be opened\n", path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // [1] - reserve space for the lines
+    if (SM_CounterReserve(fd, reserve) != 0) {
+        DS_ERROR("ERROR - SM_CounterSetMap, log file can't be reserved\n");
+        close(fd);
+        return -1;
+    }
+    cnt->map_used = 0;
+    cnt->map_size = reserve;
+
+    // [2] - map it, new processes inherit the mapping
+    SM_LogMap = mmap(NULL, cnt->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (SM_LogMap == MAP_FAILED) {
+        DS_ERROR("ERROR - SM_CounterSetMap, mmap failed\n");
+        SM_LogMap = NULL;
+        ftruncate(fd, 0);
+        close(fd);
+        return -1;
+    }
+    SM_LogMapFd = fd;
+    SM_LogMapLen = cnt->map_size;
+    cnt->map = true;
+    return 0;
+}
+
+/**
+ * Unmaps the log file and truncates it to the length of the lines. Should be called by the init process after 
+ * all the processes finished.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int return(0) if the log has it's real length, returns(-1) if not.
+ */
+int SM_CounterMapStop(PTListDataPtr shared_data)
+{
+    SM_Counter *cnt = &(shared_data->cnt);
+    if (SM_LogMapFd == -1) {
+        return 0;
+    }
+
+    int err_check = 0;
+    if (SM_LogMap != NULL) {
+        err_check += munmap(SM_LogMap, SM_LogMapLen);
+        SM_LogMap = NULL;
+        SM_LogMapLen = 0;
+    }
+    err_check += ftruncate(SM_LogMapFd, (off_t)cnt->map_used);
+    err_check += close(SM_LogMapFd);
+    SM_LogMapFd = -1;
+    cnt->map = false;
+
+    if (err_check != 0) {
+        DS_ERROR("ERROR - SM_CounterMapStop, log file can't be truncated\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Function destroys counter data and semaphores.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int return(0) if the semaphore is destroyed correctly, otherwise returns(-1)
+ */
+int SM_CounterDestroy(PTListDataPtr shared_data)
+{
+    // destroy semaphore
+    if (sem_destroy(&(shared_data->cnt.sem_1)) == -1) {
+        DS_ERROR("ERROR - SM_CounterDestroy, sem_destroy failed\n");
+        return -1;
+    }
+
+    // unset counter data
+    shared_data->cnt.sem_state = SEM_NOT_INIT;
+    shared_data->cnt.data = 0;
+    if (SM_TsFd != -1) {
+        close(SM_TsFd);
+        SM_TsFd = -1;
+    }
+
+    return 0;
+}
+
+
+
+/* - - - - - - - - - - - - */
+/*        SM_OFFICE        */
+/* - - - - - - - - - - - - */
+// Functions which implements the functionality of project IOS-Synchronizace 2022/2023
+
+/* Shards and customer records of the office mapped by the calling process (process local), they are inherited
+ * by fork and attached by name by external clients (see SM_OfficeAttach()) */
+static SM_Shard *SM_ShardArr = NULL;
+static SM_Customer *SM_CustArr = NULL;
+
+/* Tables of the timeline mapped by the calling process (process local), NULL if the timeline isn't recorded */
+static SM_CustomerRow *SM_CustRowArr = NULL;
+static SM_IntervalRow *SM_IntervalArr = NULL;
+
+/* Names of dispatch policies and topologies, used by SM_OfficeSetPolicy() and SM_OfficeSetTopology() */
+static const char *SM_PolicyNames[SM_POLICY_NUM] = {"longest", "oldest", "rr", "wfq", "sesf"};
+static const char *SM_TopologyNames[SM_TOPOLOGY_NUM] = {"global", "hash", "p2c"};
+
+/**
+ * Adds customer at the end of the queue. Caller must hold the office mutex.
+ * 
+ * @param queue Pointer to the queue.
+ * @param cust Customer array.
+ * @param index Index of the customer in the customer array.
+ */
+static void SM_QueuePush(SM_Queue *queue, SM_Customer *cust, int index)
+{
+    cust[index].next = -1;
+    cust[index].prev = queue->tail;
+    cust[index].queued = true;
+    if (queue->tail == -1) {
+        queue->head = index;
+    } else {
+        cust[queue->tail].next = index;
+    }
+    queue->tail = index;
+
+    queue->count++;
+    if (queue->count > queue->max_count) {
+        queue->max_count = queue->count;
+    }
+}
+
+/**
+ * Removes the first customer from the queue. Caller must hold the office mutex.
+ * 
+ * @param queue Pointer to the queue, must not be empty.
+ * @param cust Customer array.
+ * @return int Index of the removed customer.
+ */
+static int SM_QueuePop(SM_Queue *queue, SM_Customer *cust)
+{
+    int index = queue->head;
+    queue->head = cust[index].next;
+    if (queue->head == -1) {
+        queue->tail = -1;
+    } else {
+        cust[queue->head].prev = -1;
+    }
+    cust[index].queued = false;
+    queue->count--;
+    return index;
+}
+
+/**
+ * Removes customer from any place of the queue. Caller must hold the office mutex.
+ * 
+ * @param queue Pointer to the queue, the customer must be in it.
+ * @param cust Customer array.
+ * @param index Index of the removed customer.
+ */
+static void SM_QueueRemove(SM_Queue *queue, SM_Customer *cust, int index)
+{
+    int next = cust[index].next, prev = cust[index].prev;
+    if (prev == -1) {
+        queue->head = next;
+    } else {
+        cust[prev].next = next;
+    }
+    if (next == -1) {
+        queue->tail = prev;
+    } else {
+        cust[next].prev = prev;
+    }
+    cust[index].queued = false;
+    queue->count--;
+}
+
+/**
+ * Dispatch policy - service with the longest queue, ties are broken by starting after the last served service,
+ * so no service is preferred just because of it's number.
+ * 
+ * @param office Pointer to office data.
+ * @param shard Pointer to the shard, caller must hold it's mutex.
+ * @return int Index of the service which will be served, (-1) if all queues are empty.
+ */
+static int SM_PolicyLongest(SM_Office *office, SM_Shard *shard)
+{
+    (void)office;
+    int best = -1;
+    for (int k = 1; k <= SERVICE_NUM; k++) {
+        int i = (shard->last_service + k) % SERVICE_NUM;
+        if (shard->queue[i].count > 0 && (best == -1 || shard->queue[i].count > shard->queue[best].count)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Dispatch policy - service whose first customer entered the office first (FIFO across all queues).
+ * 
+ * @param office Pointer to office data.
+ * @param shard Pointer to the shard, caller must hold it's mutex.
+ * @return int Index of the service which will be served, (-1) if all queues are empty.
+ */
+static int SM_PolicyOldest(SM_Office *office, SM_Shard *shard)
+{
+    (void)office;
+    int best = -1;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        if (shard->queue[i].count > 0 && (best == -1 || 
+            SM_CustArr[shard->queue[i].head].t_enter < SM_CustArr[shard->queue[best].head].t_enter)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Dispatch policy - the first non-empty service after the last served service.
+ * 
+ * @param office Pointer to office data.
+ * @param shard Pointer to the shard, caller must hold it's mutex.
+ * @return int Index of the service which will be served, (-1) if all queues are empty.
+ */
+static int SM_PolicyRoundRobin(SM_Office *office, SM_Shard *shard)
+{
+    (void)office;
+    for (int k = 1; k <= SERVICE_NUM; k++) {
+        int i = (shard->last_service + k) % SERVICE_NUM;
+        if (shard->queue[i].count > 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Dispatch policy - weighted fair queueing. Every service gets a virtual finish time which grows by expected
+ * service time divided by the weight of the service, service with the smallest finish time is served.
+ * 
+ * @param office Pointer to office data.
+ * @param shard Pointer to the shard, caller must hold it's mutex.
+ * @return int Index of the service which will be served, (-1) if all queues are empty.
+ */
+static int SM_PolicyWFQ(SM_Office *office, SM_Shard *shard)
+{
+    int best = -1;
+    double best_finish = 0.0, best_cost = 0.0;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        if (shard->queue[i].count == 0) {
+            continue;
+        }
+
+        // services with zero expected time still have to advance the virtual time
+        double cost = ((office->service[i].mean > 0) ? office->service[i].mean : 1e-3) / office->weight[i];
+        double start = (shard->queue[i].finish > shard->vtime) ? shard->queue[i].finish : shard->vtime;
+        if (best == -1 || start + cost < best_finish) {
+            best = i;
+            best_finish = start + cost;
+            best_cost = cost;
+        }
+    }
+
+    if (best != -1) {
+        shard->queue[best].finish = best_finish;
+        shard->vtime = best_finish - best_cost;
+    }
+    return best;
+}
+
+/**
+ * Dispatch policy - service with the shortest expected service time, ties are broken by the longer queue.
+ * 
+ * @param office Pointer to office data.
+ * @param shard Pointer to the shard, caller must hold it's mutex.
+ * @return int Index of the service which will be served, (-1) if all queues are empty.
+ */
+static int SM_PolicySESF(SM_Office *office, SM_Shard *shard)
+{
+    int best = -1;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        if (shard->queue[i].count == 0) {
+            continue;
+        }
+        if (best == -1 || office->service[i].mean < office->service[best].mean ||
+            (office->service[i].mean == office->service[best].mean && shard->queue[i].count > shard->queue[best].count)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/* Dispatch policies, indexed by SMDispatchPolicy */
+static int (*const SM_Policies[SM_POLICY_NUM])(SM_Office *office, SM_Shard *shard) = {
+    SM_PolicyLongest, SM_PolicyOldest, SM_PolicyRoundRobin, SM_PolicyWFQ, SM_PolicySESF
+};
+
+/**
+ * Maps a part of the office which has it's own shared memory. If the shared data are named, the part is named
+ * shared memory "<name><suffix>", otherwise it's anonymous.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param suffix Suffix of the name of the part.
+ * @param size Size of the part in bytes.
+ * @param create true if the part is created (init process), false if it's attached (external client).
+ * @return void* Pointer to the part, MAP_FAILED if it couldn't be mapped.
+ */
+static void *SM_SharedMap(PTListDataPtr shared_data, const char *suffix, size_t size, bool create)
+{
+    if (shared_data->name[0] == '\0') {
+        return mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+
+    char name[PT_SEG_NAME_SIZE];
+    if (snprintf(name, PT_SEG_NAME_SIZE, "%s%s", shared_data->name, suffix) >= PT_SEG_NAME_SIZE) {
+        return MAP_FAILED;
+    }
+    int fd = shm_open(name, create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0600);
+    if (fd == -1) {
+        return MAP_FAILED;
+    }
+    if (create && ftruncate(fd, size) == -1) {
+        close(fd);
+        return MAP_FAILED;
+    }
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return ptr;
+}
+
+/**
+ * Unmaps a part of the office mapped by SM_SharedMap(), the init process removes it's name too.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param suffix Suffix of the name of the part.
+ * @param ptr Pointer to the part.
+ * @param size Size of the part in bytes.
+ * @param unlink true if the name of the part is removed.
+ * @return int returns(0) if the part was unmapped, returns(-1) if not.
+ */
+static int SM_SharedUnmap(PTListDataPtr shared_data, const char *suffix, void *ptr, size_t size, bool unlink)
+{
+    int err_check = munmap(ptr, size);
+    if (unlink && shared_data->name[0] != '\0') {
+        char name[PT_SEG_NAME_SIZE];
+        if (snprintf(name, PT_SEG_NAME_SIZE, "%s%s", shared_data->name, suffix) >= PT_SEG_NAME_SIZE) {
+            return -1;
+        }
+        err_check += shm_unlink(name);
+    }
+    return (err_check == 0) ? 0 : -1;
+}
+
+/**
+ * Creates shards of the office in a separate shared memory and initializes their queues.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param shard_num Number of shards.
+ * @return int returns(0) if the shards were created, returns(-1) if not.
+ */
+static int SM_ShardsInit(PTListDataPtr shared_data, int shard_num)
+{
+    SM_Office *office = &(shared_data->office);
+    SM_ShardArr = SM_SharedMap(shared_data, ".shard", shard_num * sizeof(SM_Shard), true);
+    if (SM_ShardArr == MAP_FAILED) {
+        DS_ERROR("ERROR - SM_ShardsInit, mmap failed (SM_Shard)\n");
+        return -1;
+    }
+    office->shard_num = shard_num;
+
+    for (int s = 0; s < shard_num; s++) {
+        SM_Shard *shard = &(SM_ShardArr[s]);
+        if (sem_init(&(shard->mutex), 1, 1) == -1) {
+            DS_ERROR("ERROR - SM_ShardsInit, sem_init failed\n");
+            return -1;
+        }
+        shard->last_service = SERVICE_NUM - 1;
+        shard->vtime = 0.0;
+        for (int i = 0; i < SERVICE_NUM; i++) {
+            shard->queue[i].head = -1;
+            shard->queue[i].tail = -1;
+            shard->queue[i].count = 0;
+            shard->queue[i].max_count = 0;
+            shard->queue[i].finish = 0.0;
+            shard->queue[i].wait_ewma = SM_SPIN_MAX_NS / 2;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Destroys shards of the office.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int returns(0) if the shards were destroyed, returns(-1) if not.
+ */
+static int SM_ShardsDestroy(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+    int err_check = 0;
+    for (int s = 0; s < office->shard_num; s++) {
+        err_check += sem_destroy(&(SM_ShardArr[s].mutex));
+    }
+    err_check += SM_SharedUnmap(shared_data, ".shard", SM_ShardArr, office->shard_num * sizeof(SM_Shard), true);
+    SM_ShardArr = NULL;
+    office->shard_num = 0;
+    return (err_check == 0) ? 0 : -1;
+}
+
+/**
+ * Returns number of customers waiting in a shard, read without the mutex.
+ * 
+ * @param shard Pointer to the shard.
+ * @return int Number of waiting customers.
+ */
+static int SM_ShardWaiting(SM_Shard *shard)
+{
+    int count = 0;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        count += __atomic_load_n(&(shard->queue[i].count), __ATOMIC_RELAXED);
+    }
+    return count;
+}
+
+/**
+ * Chooses shard in which the customer will wait. Customer number is mixed by a hash function, so customers
+ * with consecutive numbers are spread over all the shards.
+ * 
+ * @param office Pointer to office data.
+ * @param process_id Customer number.
+ * @return int Index of the shard.
+ */
+static int SM_ShardChoose(SM_Office *office, int process_id)
+{
+    if (office->shard_num == 1) {
+        return 0;
+    }
+
+    uint64_t hash = (uint64_t)process_id * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 32;
+    int first = (int)(hash % office->shard_num);
+    if (office->topology != SM_TOPOLOGY_P2C) {
+        return first;
+    }
+
+    // power of two choices, the second shard comes from the other half of the hash
+    int second = (int)((hash >> 16) % office->shard_num);
+    return (SM_ShardWaiting(&(SM_ShardArr[second])) < SM_ShardWaiting(&(SM_ShardArr[first]))) ? second : first;
+}
+
+/**
+ * Calls the first customer of the service chosen by the dispatch policy in the given shard.
+ * 
+ * @param office Pointer to office data.
+ * @param shard Pointer to the shard.
+ * @return int Index of the called customer, (-1) if the shard is empty.
+ */
+static int SM_ShardCall(SM_Office *office, SM_Shard *shard)
+{
+    int index = -1;
+
+    while (sem_wait(&(shard->mutex)) == -1 && errno == EINTR);
+    int i = SM_Policies[office->policy](office, shard);
+    if (i >= 0) {
+        shard->last_service = i;
+        index = SM_QueuePop(&(shard->queue[i]), SM_CustArr);
+    }
+    sem_post(&(shard->mutex));
+
+    return index;
+}
+
+/**
+ * Creates customer records of customers and external clients in a separate shared memory, records of external
+ * clients are put into their free-list.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int returns(0) if the records were created, returns(-1) if not.
+ */
+static int SM_CustomersInit(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+    int cust_num = office->cust_cap + office->client_cap;
+
+    SM_CustArr = SM_SharedMap(shared_data, ".cust", cust_num * sizeof(SM_Customer), true);
+    if (SM_CustArr == MAP_FAILED) {
+        DS_ERROR("ERROR - SM_OfficeInit, mmap failed (SM_Customer)\n");
+        return -1;
+    }
+
+    // initialize all semaphores
+    int err_check = 0;
+    for (int i = 0; i < cust_num; i++) {
+        err_check += sem_init(&(SM_CustArr[i].sem), 1, 0);
+    }
+    if (err_check != 0) {
+        DS_ERROR("ERROR - SM_OfficeInit, sem_init failed\n");
+        return -1;
+    }
+
+    // records of external clients are free
+    office->client_free = 0;
+    for (int i = cust_num - 1; i >= office->cust_cap; i--) {
+        SM_OfficeRecordRelease(shared_data, i);
+    }
+    return 0;
+}
+
+/**
+ * Destroys customer records.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int returns(0) if the records were destroyed, returns(-1) if not.
+ */
+static int SM_CustomersDestroy(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+    int cust_num = office->cust_cap + office->client_cap;
+
+    int err_check = 0;
+    for (int i = 0; i < cust_num; i++) {
+        err_check += sem_destroy(&(SM_CustArr[i].sem));
+    }
+    err_check += SM_SharedUnmap(shared_data, ".cust", SM_CustArr, cust_num * sizeof(SM_Customer), true);
+    SM_CustArr = NULL;
+    return (err_check == 0) ? 0 : -1;
+}
+
+/**
+ * Intializes office data and semaphores. This function must be called before using any other function.
+ * Also, this function must be called before creating new processes.
+ * Every service gets the default service time distribution, uniform in interval <0, 10> miliseconds
+ * and officers use the longest queue policy.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param customer_num Max number of customers, customer's process number must be lower.
+ * @param seed Seed of officer's random number generators, every officer takes it's own stream of it.
+ * @return int returns(0) if the function intiliazes corectly, returns(-1) if the initiliazation fails.
+ */
+int SM_OfficeInit(PTListDataPtr shared_data, int customer_num, unsigned long seed)
+{
+    SM_Office *office = &(shared_data->office);
+
+    // creating customer array, there are no external clients by default
+    office->cust_cap = (customer_num > 0) ? customer_num : 1;
+    office->client_cap = 0;
+    office->client_id = SM_CLIENT_ID_BASE;
+    if (SM_CustomersInit(shared_data) != 0) {
+        return -1;
+    }
+
+    // creating one shard shared by all officers
+    if (SM_ShardsInit(shared_data, 1) != 0) {
+        return -1;
+    }
+    office->topology = SM_TOPOLOGY_GLOBAL;
+
+    // initialising data
+    office->is_open = 1;
+    office->t_close = 0;
+    if (sem_init(&(office->closed), 1, 0) == -1) {
+        DS_ERROR("ERROR - SM_OfficeInit, sem_init failed\n");
+        return -1;
+    }
+    office->seed = seed;
+    office->policy = SM_POLICY_LONGEST;
+    office->officers = 0;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        office->weight[i] = 1.0;
+        office->queue_cap[i] = 0;
+    }
+    office->patience = 0;
+
+    // default service time distributions
+    for (int i = 1; i <= SERVICE_NUM; i++) {
+        SM_OfficeSetService(shared_data, i, "uniform:0,10");
+    }
+
+    // metrics start with the office
+    memset(&(shared_data->metrics), 0, sizeof(SM_Metrics));
+    shared_data->metrics.t_start = nsec_now();
+
+    return 0;
+}
+
+/**
+ * Sets service time distribution of a service (see DS_ServiceInit() for the format of the specification).
+ * Must be called before creating officer processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param type_of_service Type of the service <1, SERVICE_NUM>.
+ * @param spec Specification of the distribution.
+ * @return int returns(0) if the distribution was set, returns(-1) if the specification is wrong.
+ */
+int SM_OfficeSetService(PTListDataPtr shared_data, int type_of_service, const char *spec)
+{
+    if (type_of_service < 1 || type_of_service > SERVICE_NUM) {
+        DS_ERROR("ERROR - SM_OfficeSetService, wrong type of service\n");
+        return -1;
+    }
+
+    return DS_ServiceInit(&(shared_data->office.service[type_of_service - 1]), spec);
+}
+
+/**
+ * Sets dispatch policy of officers. Policies are "longest", "oldest", "rr", "wfq" and "sesf".
+ * Must be called before creating officer processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param name Name of the policy.
+ * @return int returns(0) if the policy was set, returns(-1) if the policy doesn't exist.
+ */
+int SM_OfficeSetPolicy(PTListDataPtr shared_data, const char *name)
+{
+    for (int i = 0; i < SM_POLICY_NUM; i++) {
+        if (strcmp(name, SM_PolicyNames[i]) == 0) {
+            shared_data->office.policy = i;
+            return 0;
+        }
+    }
+
+    DS_ERROR("ERROR - SM_OfficeSetPolicy, unknown policy %s\n", name);
+    return -1;
+}
+
+/**
+ * Sets weights of services used by weighted fair queueing policy, weights are separated by commas ("2,1,1").
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param weights Weights of services 1, 2 and 3.
+ * @return int returns(0) if the weights were set, returns(-1) if the weights are wrong.
+ */
+int SM_OfficeSetWeights(PTListDataPtr shared_data, const char *weights)
+{
+    const char *ptr = weights;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        char *endptr;
+        double weight = strtod(ptr, &endptr);
+        if (endptr == ptr || weight <= 0 || (*endptr != ',' && *endptr != '\0') || (*endptr == '\0' && i != SERVICE_NUM - 1)) {
+            DS_ERROR("ERROR - SM_OfficeSetWeights, wrong weights %s\n", weights);
+            return -1;
+        }
+        shared_data->office.weight[i] = weight;
+        ptr = endptr + 1;
+    }
+    return 0;
+}
+
+/**
+ * Sets max lengths of queues of services in form "C" (same for all the services) or "C1,C2,C3". Customers who 
+ * arrive at a full queue are rejected. With more shards every shard has queues of this length.
+ * Must be called before creating any processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param caps Lengths of the queues, (0) means unlimited.
+ * @return int returns(0) if the lengths were set, returns(-1) if they are wrong.
+ */
+int SM_OfficeSetQueueCap(PTListDataPtr shared_data, const char *caps)
+{
+    const char *ptr = caps;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        char *endptr;
+        long cap = strtol(ptr, &endptr, 10);
+        if (endptr == ptr || cap < 0 || cap > INT_MAX || (*endptr != ',' && *endptr != '\0')) {
+            DS_ERROR("ERROR - SM_OfficeSetQueueCap, wrong queue caps %s\n", caps);
+            return -1;
+        }
+        shared_data->office.queue_cap[i] = (int)cap;
+
+        // one cap for all the services
+        if (*endptr == '\0' && i == 0) {
+            for (int j = 1; j < SERVICE_NUM; j++) {
+                shared_data->office.queue_cap[j] = (int)cap;
+            }
+            return 0;
+        }
+        if ((*endptr == '\0') != (i == SERVICE_NUM - 1)) {
+            DS_ERROR("ERROR - SM_OfficeSetQueueCap, wrong queue caps %s\n", caps);
+            return -1;
+        }
+        ptr = endptr + 1;
+    }
+    return 0;
+}
+
+/**
+ * Sets patience of customers, customers who aren't called in time leave the queue and go home.
+ * Must be called before creating any processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param patience_ms Patience in miliseconds, (0) means customers wait forever.
+ * @return int returns(0).
+ */
+int SM_OfficeSetPatience(PTListDataPtr shared_data, unsigned int patience_ms)
+{
+    shared_data->office.patience = (uint64_t)patience_ms * DS_NSEC_PER_MSEC;
+    return 0;
+}
+
+/**
+ * Sets topology of the office. Topologies are "global" (one shard shared by all officers), "hash" (customer waits 
+ * in a shard chosen by hash of his number) and "p2c" (customer waits in the shorter of two hashed shards).
+ * Officer serves his home shard and steals customers from the busiest shard when it's empty.
+ * Must be called before creating any processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param name Name of the topology.
+ * @param shard_num Number of shards, ignored by the global topology.
+ * @return int returns(0) if the topology was set, returns(-1) if the topology doesn't exist.
+ */
+int SM_OfficeSetTopology(PTListDataPtr shared_data, const char *name, int shard_num)
+{
+    SM_Office *office = &(shared_data->office);
+
+    for (int i = 0; i < SM_TOPOLOGY_NUM; i++) {
+        if (strcmp(name, SM_TopologyNames[i]) == 0) {
+            if (i == SM_TOPOLOGY_GLOBAL || shard_num < 1) {
+                shard_num = 1;
+            }
+            office->topology = i;
+            if (SM_ShardsDestroy(shared_data) != 0) {
+                return -1;
+            }
+            return SM_ShardsInit(shared_data, shard_num);
+        }
+    }
+
+    DS_ERROR("ERROR - SM_OfficeSetTopology, unknown topology %s\n", name);
+    return -1;
+}
+
+/**
+ * Sets number of records of external clients, who attach to the named office (see SM_OfficeAttach()).
+ * Must be called before any process uses the office.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param client_num Number of external clients which can be in the office at the same time.
+ * @return int returns(0) if the records were created, returns(-1) if not.
+ */
+int SM_OfficeSetClients(PTListDataPtr shared_data, int client_num)
+{
+    if (client_num < 0) {
+        DS_ERROR("ERROR - SM_OfficeSetClients, wrong number of clients\n");
+        return -1;
+    }
+    if (SM_CustomersDestroy(shared_data) != 0) {
+        return -1;
+    }
+    shared_data->office.client_cap = client_num;
+    return SM_CustomersInit(shared_data);
+}
+
+/**
+ * Sets log file of the office, external clients open it for appending.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param path Path of the log file.
+ * @return int returns(0) if the path was set, returns(-1) if not.
+ */
+int SM_OfficeSetLog(PTListDataPtr shared_data, const char *path)
+{
+    if (realpath(path, shared_data->office.log_path) == NULL) {
+        DS_ERROR("ERROR - SM_OfficeSetLog, wrong path %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Attaches named office created by PT_InitNamed() in another program. Shared data, shards and customer records
+ * are mapped into the calling process, so it can use SM_OfficeService() like customers of the office.
+ * 
+ * @param name Name of the shared memory of the office.
+ * @return PTListDataPtr Pointer to shared_data, NULL if the office doesn't exist.
+ */
+PTListDataPtr SM_OfficeAttach(const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1) {
+        DS_ERROR("ERROR - SM_OfficeAttach, office %s doesn't exist\n", name);
+        return NULL;
+    }
+    PTListDataPtr shared_data = mmap(NULL, sizeof(struct PTListData), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared_data == MAP_FAILED) {
+        DS_ERROR("ERROR - SM_OfficeAttach, mmap failed (PTListData)\n");
+        return NULL;
+    }
+
+    SM_Office *office = &(shared_data->office);
+    SM_ShardArr = SM_SharedMap(shared_data, ".shard", office->shard_num * sizeof(SM_Shard), false);
+    SM_CustArr = SM_SharedMap(shared_data, ".cust", (office->cust_cap + office->client_cap) * sizeof(SM_Customer), false);
+    if (SM_ShardArr == MAP_FAILED || SM_CustArr == MAP_FAILED) {
+        DS_ERROR("ERROR - SM_OfficeAttach, mmap failed (SM_Shard, SM_Customer)\n");
+        return NULL;
+    }
+
+    // lines of external clients go through the log ring too
+    if (shared_data->cnt.ring) {
+        SM_LogRing = SM_SharedMap(shared_data, ".log", LW_RingBytes(LW_RING_SIZE), false);
+        if (SM_LogRing == MAP_FAILED) {
+            DS_ERROR("ERROR - SM_OfficeAttach, mmap failed (LWRing)\n");
+            SM_LogRing = NULL;
+            return NULL;
+        }
+    }
+
+    // lines of external clients are copied into the mapped log too
+    if (shared_data->cnt.map && (SM_LogMapFd = open(shared_data->cnt.map_path, O_RDWR)) == -1) {
+        DS_ERROR("ERROR - SM_OfficeAttach, log file can't be opened for mapping\n");
+        return NULL;
+    }
+
+    // lines of external clients are timestamped too
+    if (shared_data->cnt.ts_path[0] != '\0' && (SM_TsFd = open(shared_data->cnt.ts_path, O_WRONLY)) == -1) {
+        DS_ERROR("ERROR - SM_OfficeAttach, timestamp file can't be opened\n");
+        return NULL;
+    }
+
+    // customers of external clients are recorded into the timeline too
+    SM_Timeline *timeline = &(shared_data->timeline);
+    if (timeline->enabled) {
+        SM_CustRowArr = SM_SharedMap(shared_data, ".tl.cust", timeline->capacity * sizeof(SM_CustomerRow), false);
+        SM_IntervalArr = SM_SharedMap(shared_data, ".tl.int", timeline->capacity * sizeof(SM_IntervalRow), false);
+        if (SM_CustRowArr == MAP_FAILED || SM_IntervalArr == MAP_FAILED) {
+            DS_ERROR("ERROR - SM_OfficeAttach, mmap failed (SM_CustomerRow, SM_IntervalRow)\n");
+            return NULL;
+        }
+    }
+    return shared_data;
+}
+
+/**
+ * Detaches office attached by SM_OfficeAttach(), the office keeps running.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int returns(0) if the office was detached, returns(-1) if not.
+ */
+int SM_OfficeDetach(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+    int err_check = 0;
+    err_check += SM_SharedUnmap(shared_data, ".shard", SM_ShardArr, office->shard_num * sizeof(SM_Shard), false);
+    err_check += SM_SharedUnmap(shared_data, ".cust", SM_CustArr, (office->cust_cap + office->client_cap) * sizeof(SM_Customer), false);
+    if (SM_CustRowArr != NULL) {
+        uint64_t capacity = shared_data->timeline.capacity;
+        err_check += SM_SharedUnmap(shared_data, ".tl.cust", SM_CustRowArr, capacity * sizeof(SM_CustomerRow), false);
+        err_check += SM_SharedUnmap(shared_data, ".tl.int", SM_IntervalArr, capacity * sizeof(SM_IntervalRow), false);
+        SM_CustRowArr = NULL;
+        SM_IntervalArr = NULL;
+    }
+    if (SM_TsFd != -1) {
+        err_check += close(SM_TsFd);
+        SM_TsFd = -1;
+    }
+    if (SM_LogRing != NULL) {
+        err_check += SM_SharedUnmap(shared_data, ".log", SM_LogRing, LW_RingBytes(LW_RING_SIZE), false);
+        SM_LogRing = NULL;
+    }
+    if (SM_LogMapFd != -1) {
+        if (SM_LogMap != NULL) {
+            err_check += munmap(SM_LogMap, SM_LogMapLen);
+        }
+        err_check += close(SM_LogMapFd);
+        SM_LogMap = NULL;
+        SM_LogMapLen = 0;
+        SM_LogMapFd = -1;
+    }
+    err_check += munmap(shared_data, sizeof(struct PTListData));
+    SM_ShardArr = NULL;
+    SM_CustArr = NULL;
+    return (err_check == 0) ? 0 : -1;
+}
+
+/**
+ * Takes a free record of an external client. The free-list is lock-free, like the free-list of the process table.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int Index of the record, (-1) if all the records are taken.
+ */
+int SM_OfficeRecordAcquire(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+    uint64_t head = __atomic_load_n(&(office->client_free), __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    int record;
+    do {
+        record = (int)(uint32_t)head - 1;
+        if (record == -1) {
+            return -1;
+        }
+        int next = __atomic_load_n(&(SM_CustArr[record].next_free), __ATOMIC_RELAXED);
+        new_head = (((head >> 32) + 1) << 32) | (uint32_t)(next + 1);
+    } while (!__atomic_compare_exchange_n(&(office->client_free), &head, new_head, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return record;
+}
+
+/**
+ * Returns record of an external client to the free-list.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param record Index of the record.
+ */
+void SM_OfficeRecordRelease(PTListDataPtr shared_data, int record)
+{
+    SM_Office *office = &(shared_data->office);
+    uint64_t head = __atomic_load_n(&(office->client_free), __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    do {
+        __atomic_store_n(&(SM_CustArr[record].next_free), (int)(uint32_t)head - 1, __ATOMIC_RELAXED);
+        new_head = (((head >> 32) + 1) << 32) | (uint32_t)(record + 1);
+    } while (!__atomic_compare_exchange_n(&(office->client_free), &head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Function closes the office, sets the office.is_open to closed state (0). Customers who didn't enter
+ * the office before it's closed won't get in, all the shards are locked, so nobody is entering right now.
+ * 
+ * @param shared_data Pointer to shared_data.
+ */
+void SM_OfficeClose(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+
+    // closing office
+    // init process can be interrupted by SIGCHLD
+    for (int s = 0; s < office->shard_num; s++) {
+        while (sem_wait(&(SM_ShardArr[s].mutex)) == -1 && errno == EINTR);
+    }
+    __atomic_store_n(&(office->is_open), 0, __ATOMIC_RELEASE);
+    for (int s = office->shard_num - 1; s >= 0; s--) {
+        sem_post(&(SM_ShardArr[s].mutex));
+    }
+
+    // wake up everybody who waits for the closing (only the first closing counts)
+    if (__atomic_exchange_n(&(office->t_close), nsec_now(), __ATOMIC_ACQ_REL) == 0) {
+        sem_post(&(office->closed));
+    }
+}
+
+/**
+ * Waits until the office closes, but at most msec miliseconds. Used instead of sleeping by officers on a break 
+ * and customers going to the office, so they react to closing immediately.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param msec Max time of waiting in miliseconds.
+ * @return int return(1) if the office is closed, return(0) if the time ran out, PT_ERR_SYS if waiting failed.
+ */
+int SM_OfficeWaitClose(PTListDataPtr shared_data, long msec)
+{
+    SM_Office *office = &(shared_data->office);
+
+    // deadline is monotonic, so steps of the wall clock don't stretch or cut the wait
+    uint64_t deadline = nsec_now() + (uint64_t)msec * DS_NSEC_PER_MSEC;
+    struct timespec ts;
+    ts.tv_sec = deadline / DS_NSEC_PER_SEC;
+    ts.tv_nsec = deadline % DS_NSEC_PER_SEC;
+
+    int ret;
+    PT_ProcessSleep(true);
+    while ((ret = sem_clockwait(&(office->closed), CLOCK_MONOTONIC, &ts)) == -1 && errno == EINTR);
+    PT_ProcessSleep(false);
+
+    if (ret == 0) {
+        // latch stays open for others
+        sem_post(&(office->closed));
+        return 1;
+    }
+    return (errno == ETIMEDOUT) ? 0 : PT_ERR_SYS;
+}
+
+/**
+ * Process prints that it's going home, the time is recorded so the drain time of the office can be reported.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param log_file Pointer to file where the data will be printed.
+ * @param role Role of the process ("Z" or "U").
+ * @param process_id Number of the process.
+ * @return int return(0) if the message was printed, PT_ERR_SYS if not.
+ */
+int SM_OfficeGoHome(PTListDataPtr shared_data, FILE *log_file, const char *role, int process_id)
+{
+    int ret = SM_CounterEvent(shared_data, log_file, (role[0] == 'U') ? EV_U_HOME : EV_Z_HOME, process_id, 0);
+
+    // the last one wins
+    uint64_t now = nsec_now(), last = __atomic_load_n(&(shared_data->metrics.t_last_home), __ATOMIC_RELAXED);
+    while (last < now && !__atomic_compare_exchange_n(&(shared_data->metrics.t_last_home), &last, now, false, 
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return ret;
+}
+
+/**
+ * Function destroys office data and semaphores.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int return(0) if the semaphore is destroyed correctly, otherwise returns(-1) 
+*/
+int SM_OfficeDestroy(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+
+    // unset data
+    office->is_open = 0;
+
+    // destroy semaphores, shards and customer array
+    int err_check = sem_destroy(&(office->closed));
+    err_check += SM_ShardsDestroy(shared_data);
+    err_check += SM_CustomersDestroy(shared_data);
+
+    if (err_check != 0) {
+        DS_ERROR("ERROR - SM_OfficeDestroy, destroying office failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns number of customers waiting in all queues. The queues are read without the mutex,
+ * so the number is only approximate.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int Number of waiting customers.
+ */
+int SM_OfficeWaiting(PTListDataPtr shared_data)
+{
+    int count = 0;
+    for (int s = 0; s < shared_data->office.shard_num; s++) {
+        count += SM_ShardWaiting(&(SM_ShardArr[s]));
+    }
+    return count;
+}
+
+/**
+ * Officer starts working in the office, called by the init process before the officer is created.
+ * 
+ * @param shared_data Pointer to shared_data.
+ */
+void SM_OfficeHire(PTListDataPtr shared_data)
+{
+    __atomic_fetch_add(&(shared_data->office.officers), 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Idle officer leaves the office, but only if there would be at least min_officers officers left.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param min_officers Minimum number of officers in the office.
+ * @return int returns(1) if the officer can go home, otherwise returns(0)
+ */
+int SM_OfficeRetire(PTListDataPtr shared_data, int min_officers)
+{
+    int officers = __atomic_load_n(&(shared_data->office.officers), __ATOMIC_RELAXED);
+    while (officers > min_officers) {
+        if (__atomic_compare_exchange_n(&(shared_data->office.officers), &officers, officers - 1, false, 
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Returns number of officers working in the office.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int Number of officers.
+ */
+int SM_OfficeOfficers(PTListDataPtr shared_data)
+{
+    return __atomic_load_n(&(shared_data->office.officers), __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns number of bytes of shared memory allocated by the office (customer records and shards).
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return size_t Number of bytes
+ */
+size_t SM_OfficeFootprint(PTListDataPtr shared_data)
+{
+    SM_Office *office = &(shared_data->office);
+    return (office->cust_cap + office->client_cap) * sizeof(SM_Customer) + office->shard_num * sizeof(SM_Shard);
+}
+
+/**
+ * Function used by SM_OfficeServe function. Process which calls this function takes a break, the break ends early
+ * when the office closes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param log_file Pointer to file where the data will be printed
+ * @param process_id Process identifier, but it's not pid_t, it's an another indentification number.
+ * @param max_break_time Maximum random time which the process will be put to sleep.
+ * @return int return(0) if the break occured correctyl, otherwise returns(-1) 
+ */
+int SM_OfficeBreak(PTListDataPtr shared_data, FILE *log_file, int process_id, unsigned int max_break_time)
+{
+    int err_value = 0;
+
+    // take a break
+    err_value += SM_CounterEvent(shared_data, log_file, EV_U_BREAK, process_id, 0);
+
+    // wait for random time or until the office closes
+    err_value += (SM_OfficeWaitClose(shared_data, ran_msec(0, max_break_time)) < 0);
+
+    // break is over
+    err_value += SM_CounterEvent(shared_data, log_file, EV_U_BREAK_END, process_id, 0);
+
+    // check if there was an error
+    if (err_value != 0) {
+        return PT_ERR_SYS;
+    }
+
+    return 0;
+}
+
+/**
+ * Process which calls this function serves a service to a customer process. (In form of messages).
+ * This function should be called by officer type process. The service is chosen by the dispatch policy
+ * of the office and the first customer in it's queue is called. Officer looks into his home shard first, 
+ * when it's empty he steals a customer from the busiest shard.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param log_file Pointer to file where the data will be printed
+ * @param process_id Process identifier, but it's not pid_t, it's an another indentification number.
+ * @param max_break_time maximum ammount of time which the process will be put to sleep if it takes a break.
+ * @return int return(0) if the service was served, return(2) if officer took a break, return(1) if the office is 
+ *             closed and nobody is waiting (officer can go home), otherwise returns(-1) 
+ */
+int SM_OfficeServe(PTListDataPtr shared_data, FILE *log_file, int process_id, unsigned int max_break_time)
+{
+    // every officer process has it's own random number generator
+    static DSRandom rng;
+    static bool rng_init = false;
+    if (!rng_init) {
+        DS_RandomSeedStream(&rng, shared_data->office.seed, DS_STREAM_OFFICER, (unsigned int)process_id);
+        rng_init = true;
+    }
+
+    SM_Office *office = &(shared_data->office);
+
+    // [0] - choosing the service which is going to be served and calling it's first customer
+    int index = SM_OfficeCall(shared_data, process_id);
+
+    // [1] - if there is no one waiting, officer takes a break or goes home if the office is closed and all queues are empty
+    if (index == -1) {
+        if (__atomic_load_n(&(office->is_open), __ATOMIC_ACQUIRE) == 0) {
+            return (SM_OfficeWaiting(shared_data) == 0) ? 1 : 0;
+        }
+        return (SM_OfficeBreak(shared_data, log_file, process_id, max_break_time) == 0) ? 2 : -1;
+    }
+
+    // calculate how long it takes to serve the service from service's distribution, in microseconds
+    SM_Customer *cust = &(SM_CustArr[index]);
+    int i = cust->service - 1, type = cust->service;
+    // heavy tails can exceed range of microseconds in unsigned int (71 minutes), they are clamped
+    double sample = DS_ServiceSample(&(office->service[i]), &rng) * 1000;
+    unsigned int time = (sample < (double)UINT_MAX) ? (unsigned int)sample : UINT_MAX;
+    cust->timeout = time;
+
+    // [2] - officer serves the service
+    MT_HistogramRecord(&(shared_data->metrics.wait[i]), nsec_now() - cust->t_enter);
+    MT_HistogramRecord(&(shared_data->metrics.service[i]), time * 1000ULL);
+
+    // print which service is going to be served, before the customer is woken up
+    SM_CounterEvent(shared_data, log_file, EV_U_SERVING, process_id, type);
+
+    // synchronise with the called customer
+    sem_post(&(cust->sem));
+
+    // work on the service
+    usec_sleep(time);
+    
+    // print that service is done
+    SM_CounterEvent(shared_data, log_file, EV_U_SERVED, process_id, 0);
+
+    return 0;
+}
+
+/**
+ * Calls the first customer of the service chosen by the dispatch policy, the customer isn't woken up. Officer looks 
+ * into his home shard first, when it's empty he steals a customer from the busiest shard.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param process_id Number of the officer.
+ * @return int Index of the record of the called customer, (-1) if nobody is waiting.
+ */
+int SM_OfficeCall(PTListDataPtr shared_data, int process_id)
+{
+    SM_Office *office = &(shared_data->office);
+    int index = SM_ShardCall(office, &(SM_ShardArr[process_id % office->shard_num]));
+
+    // home shard is empty, stealing from the busiest shard
+    if (index == -1 && office->shard_num > 1) {
+        int busiest = -1, busiest_count = 0;
+        for (int s = 0; s < office->shard_num; s++) {
+            int count = SM_ShardWaiting(&(SM_ShardArr[s]));
+            if (count > busiest_count) {
+                busiest = s;
+                busiest_count = count;
+            }
+        }
+        if (busiest != -1) {
+            index = SM_ShardCall(office, &(SM_ShardArr[busiest]));
+        }
+    }
+    return index;
+}
+
+/**
+ * Lets the other hardware thread of the core run while spinning.
+ */
+static inline void SM_CpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/**
+ * Customer waits until an officer calls him. If the recent waits in his queue were short, he spins with exponential
+ * backoff for about twice their average, then yields the processor a few times and only then blocks on his
+ * semaphore. Observed waiting time updates the average of the queue, lost updates of concurrent customers
+ * don't matter. Patient customer blocks with sem_clockwait() until the monotonic deadline.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param cust Pointer to the customer record, customer is already in the queue.
+ * @param deadline Monotonic time (nsec_now()) when the customer stops waiting, (0) means he waits forever.
+ * @return int return(0) if the customer was called, return(1) if the deadline passed.
  */
-int SM_CounterInit(PTListDataPtr shared_data)
+static int SM_CustomerWait(PTListDataPtr shared_data, SM_Customer *cust, uint64_t deadline)
 {
-    // semaphore is already initialised 
-    if (shared_data->cnt.sem_state == SEM_INIT) {
-        fprintf(stderr, "ERROR - SM_CounterInit, semaphore is already initialised\n");
-        return -1;
+    SM_Queue *queue = &(SM_ShardArr[cust->shard].queue[cust->service - 1]);
+    SM_Metrics *metrics = &(shared_data->metrics);
+    uint64_t start = nsec_now();
+    uint64_t ewma = __atomic_load_n(&(queue->wait_ewma), __ATOMIC_RELAXED);
+    uint64_t budget = (ewma <= SM_SPIN_MAX_NS) ? 2 * ewma : 0;
+    uint64_t *wake = &(metrics->wake_block);
+
+    // [0] - spin with exponential backoff while the budget lasts
+    int woken = 0;
+    for (int backoff = 1; budget > 0; backoff = MIN(2 * backoff, SM_SPIN_BACKOFF)) {
+        if (sem_trywait(&(cust->sem)) == 0) {
+            woken = 1;
+            wake = &(metrics->wake_spin);
+            break;
+        }
+        if (nsec_now() - start >= budget) {
+            break;
+        }
+        for (int i = 0; i < backoff; i++) {
+            SM_CpuRelax();
+        }
     }
-    
-    // initialising counter data
-    shared_data->cnt.sem_state = SEM_INIT;
-    shared_data->cnt.data = 1;
 
-    // initialising semaphore 1
-    if (sem_init(&(shared_data->cnt.sem_1), 1, 1) == -1) {
-        fprintf(stderr, "ERROR - SM_CounterInit, sem_init failed\n");
-        return -1;
+    // [1] - give the processor to the officer a few times
+    for (int i = 0; !woken && budget > 0 && i < SM_YIELD_TRIES; i++) {
+        sched_yield();
+        if (sem_trywait(&(cust->sem)) == 0) {
+            woken = 1;
+            wake = &(metrics->wake_yield);
+        }
+    }
+
+    // [2] - block until called or until the patience runs out
+    if (!woken && deadline == 0) {
+        PT_ProcessSleep(true);
+        while (sem_wait(&(cust->sem)) == -1 && errno == EINTR);
+        PT_ProcessSleep(false);
+    } else if (!woken) {
+        struct timespec ts;
+        ts.tv_sec = deadline / DS_NSEC_PER_SEC;
+        ts.tv_nsec = deadline % DS_NSEC_PER_SEC;
+
+        int ret;
+        PT_ProcessSleep(true);
+        while ((ret = sem_clockwait(&(cust->sem), CLOCK_MONOTONIC, &ts)) == -1 && errno == EINTR);
+        PT_ProcessSleep(false);
+        if (ret == -1) {
+            return 1;
+        }
     }
 
+    // [3] - update the average waiting time of the queue
+    uint64_t waited = nsec_now() - start;
+    __atomic_store_n(&(queue->wait_ewma), ewma - (ewma >> SM_EWMA_SHIFT) + (waited >> SM_EWMA_SHIFT), __ATOMIC_RELAXED);
+    __atomic_add_fetch(wake, 1, __ATOMIC_RELAXED);
     return 0;
 }
 
 /**
- * Function which prints message with counter data and increments the counter.
+ * Customer who ran out of patience leaves the queue. If an officer called him in the meantime, he stays and waits
+ * for the officer instead.
  * 
  * @param shared_data Pointer to shared_data.
- * @param file Pointer to file where the data will be printed
- * @param message Message which will be printed with counter data in the format: "counter: message"
- * @return int returns(0) if the function intiliazes corectly, returns(-1) if the initiliazation fails.
+ * @param log_file Pointer to file where the data will be printed.
+ * @param process_id Number of the customer.
+ * @param record Index of the customer record.
+ * @return int return(1) if the customer left the queue, return(0) if he was called.
  */
-int SM_CounterPrint(PTListDataPtr shared_data, FILE *file, char *message)
+static int SM_CustomerRenege(PTListDataPtr shared_data, FILE *log_file, int process_id, int record)
 {
-    // [0] - SEM-WAIT
-    // increasing number of sleeping processes
-    if (sem_wait(&(shared_data->cnt.sem_1)) == -1) {
-        fprintf(stderr, "ERROR\n");
-        return -1;
+    SM_Customer *cust = &(SM_CustArr[record]);
+    SM_Shard *shard = &(SM_ShardArr[cust->shard]);
+
+    // officers call customers under the mutex of the shard, so the customer is either in the queue or called
+    while (sem_wait(&(shard->mutex)) == -1 && errno == EINTR);
+    if (!cust->queued) {
+        sem_post(&(shard->mutex));
+        while (sem_wait(&(cust->sem)) == -1 && errno == EINTR);
+        return 0;
     }
 
-    // [1] - PRINT
-    // print message and increment counter
-    fprintf(file, "%d: %s\n", shared_data->cnt.data++, message);
-    fflush(file);
+    SM_QueueRemove(&(shard->queue[cust->service - 1]), SM_CustArr, record);
+    SM_CounterEvent(shared_data, log_file, EV_Z_RENEGED, process_id, cust->service);
+    sem_post(&(shard->mutex));
 
-    // [2] - SEMPOST
-    if (sem_post(&(shared_data->cnt.sem_1)) == -1) {
-        fprintf(stderr, "ERROR - SM_CounterPrint, sem_post failed\n");
-        return -1;
+    __atomic_add_fetch(&(shared_data->metrics.reneged[cust->service - 1]), 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+/**
+ * Customer enters the office and goes to the end of the queue of his service, if the office is open. Entering
+ * is printed under the mutex of the shard, so it can't be printed after closing.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param log_file Pointer to file where the data will be printed, NULL if nothing is printed (mapped log is
+ *                 printed without a file).
+ * @param process_id Number of the customer.
+ * @param record Index of the customer record.
+ * @param type_of_service Type of service which is requested by the process.
+ * @return int return(0) if the customer entered, return(1) if the office is closed, PT_REJECTED if the queue is full,
+ *             PT_ERR_ARG if the arguments are wrong
+ */
+int SM_OfficeEnter(PTListDataPtr shared_data, FILE *log_file, int process_id, int record, int type_of_service)
+{
+    SM_Office *office = &(shared_data->office);
+
+    // check the arguments
+    if (type_of_service < 1 || type_of_service > SERVICE_NUM || record < 0 || record >= office->cust_cap + office->client_cap) {
+        return PT_ERR_ARG;
+    }
+
+    SM_Customer *cust = &(SM_CustArr[record]);
+
+    // closing can't happen in between checking and entering
+    int s = SM_ShardChoose(office, process_id);
+    SM_Shard *shard = &(SM_ShardArr[s]);
+    while (sem_wait(&(shard->mutex)) == -1 && errno == EINTR);
+    if (office->is_open == 0) {
+        sem_post(&(shard->mutex));
+        return 1;
+    }
+
+    // full queue turns the customer away
+    SM_Queue *queue = &(shard->queue[type_of_service - 1]);
+    if (office->queue_cap[type_of_service - 1] > 0 && queue->count >= office->queue_cap[type_of_service - 1]) {
+        if (log_file != NULL || SM_LogMapFd != -1) {
+            SM_CounterEvent(shared_data, log_file, EV_Z_REJECTED, process_id, type_of_service);
+        }
+        sem_post(&(shard->mutex));
+        __atomic_add_fetch(&(shared_data->metrics.rejected[type_of_service - 1]), 1, __ATOMIC_RELAXED);
+        return PT_REJECTED;
+    }
+
+    if (log_file != NULL || SM_LogMapFd != -1) {
+        SM_CounterEvent(shared_data, log_file, EV_Z_ENTER, process_id, type_of_service);
     }
 
+    cust->service = type_of_service;
+    cust->shard = s;
+    cust->t_enter = nsec_now();
+    SM_QueuePush(queue, SM_CustArr, record);
+    sem_post(&(shard->mutex));
+
     return 0;
 }
 
 /**
- * Function destroys counter data and semaphores.
+ * Process which calls this function get's serverd a service which is requested by officer process. (In form of messages).
+ * This function should be called by customer type process. Customer enters the office only if it's open.
  * 
  * @param shared_data Pointer to shared_data.
- * @return int return(0) if the semaphore is destroyed correctly, otherwise returns(-1)
+ * @param log_file Pointer to file where the data will be printed
+ * @param process_id Process identifier, but it's not pid_t, it's an another indentification number.
+ * @param record Index of the customer record, unique among customers in the office at the same time (it can be process_id).
+ * @param type_of_service Type of service which is requested by the process.
+ * @return int return(0) if the process was served correctly, return(1) if the office is closed, otherwise returns(-1) 
  */
-int SM_CounterDestroy(PTListDataPtr shared_data)
+int SM_OfficeService(PTListDataPtr shared_data, FILE *log_file, int process_id, int record, int type_of_service)
 {
-    // destroy semaphore
-    if (sem_destroy(&(shared_data->cnt.sem_1)) == -1) {
-        fprintf(stderr, "ERROR - SM_CounterDestroy, sem_destroy failed\n");
-        return -1;
+    // [0] - enter the office and go to the end of the queue in the chosen shard
+    int ret = SM_OfficeEnter(shared_data, log_file, process_id, record, type_of_service);
+    if (ret != 0) {
+        return ret;
     }
 
-    // unset counter data
-    shared_data->cnt.sem_state = SEM_NOT_INIT;
-    shared_data->cnt.data = 0;
+    SM_Customer *cust = &(SM_CustArr[record]);
+
+    // [1] - wait until an officer calls the customer, impatient customer leaves the queue
+    uint64_t patience = shared_data->office.patience;
+    if (SM_CustomerWait(shared_data, cust, (patience > 0) ? cust->t_enter + patience : 0) != 0 &&
+        SM_CustomerRenege(shared_data, log_file, process_id, record) != 0) {
+        return PT_RENEGED;
+    }
+
+    // print that customer is being served
+    SM_CounterEvent(shared_data, log_file, EV_Z_CALLED, process_id, 0);
+
+    // wait for the service to be done depending on the time officer needs to serve the service
+    usec_sleep(cust->timeout);
 
     return 0;
 }
@@ -398,252 +2726,567 @@ int SM_CounterDestroy(PTListDataPtr shared_data)
 
 
 /* - - - - - - - - - - - - */
-/*        SM_OFFICE        */
+/*        SM_METRICS       */
 /* - - - - - - - - - - - - */
-// Functions which implements the functionality of project IOS-Synchronizace 2022/2023
+// Functions which report metrics recorded by office functions
 
 /**
- * Intializes office data and semaphores. This function must be called before using any other function.
- * Also, this function must be called before creating new processes.
+ * Adds time since the previous event of the officer to what he was doing - serving, on a break or idle. Called
+ * by the officer process for each of it's events, so it's own row isn't shared, the total is updated atomically.
  * 
  * @param shared_data Pointer to shared_data.
- * @return int returns(0) if the function intiliazes corectly, returns(-1) if the initiliazation fails.
+ * @param event Event of the officer.
+ * @param id Number of the officer.
  */
-int SM_OfficeInit(PTListDataPtr shared_data)
+static void SM_MetricsOfficer(PTListDataPtr shared_data, EVEvent event, int id)
 {
-    // initialize all semaphores
-    int err_check = 0;
-    err_check += sem_init(&(shared_data->office.sem_1), 1, 0);
-    err_check += sem_init(&(shared_data->office.sem_2), 1, 0);
-    err_check += sem_init(&(shared_data->office.sem_3), 1, 0);
-
-    if (err_check != 0) {
-        fprintf(stderr, "ERROR - SM_OfficeInit, sem_init failed\n");
-        return -1;
+    // event which started what the officer is doing (process local)
+    static uint64_t last = 0;
+    static EVEvent doing = EV_U_START;
+    SM_Metrics *metrics = &(shared_data->metrics);
+    uint64_t now = nsec_now();
+
+    // [0] - officer is counted from his start
+    if (event == EV_U_START) {
+        int num = id + 1, cur = __atomic_load_n(&(metrics->officer_num), __ATOMIC_RELAXED);
+        while (cur < num && !__atomic_compare_exchange_n(&(metrics->officer_num), &cur, num, false,
+                                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        last = now;
+        doing = event;
+        return;
+    }
+    if (last == 0) {
+        return;
     }
 
-    // initialising data
-    shared_data->office.is_open = 1;
-    shared_data->office.sem_1_count = 0;
-    shared_data->office.sem_2_count = 0;
-    shared_data->office.sem_3_count = 0;
-
-    return 0;
+    // [1] - time since the previous event
+    SM_OfficerTime delta = {0, 0, 0, (event == EV_U_SERVED) ? 1 : 0};
+    if (doing == EV_U_SERVING) {
+        delta.serving = now - last;
+    } else if (doing == EV_U_BREAK) {
+        delta.rest = now - last;
+    } else {
+        delta.idle = now - last;
+    }
+    last = now;
+    doing = event;
+
+    if (id >= 0 && id < SM_METRICS_OFFICERS) {
+        SM_OfficerTime *own = &(metrics->officer[id]);
+        own->serving += delta.serving;
+        own->rest += delta.rest;
+        own->idle += delta.idle;
+        own->served += delta.served;
+    }
+    __atomic_add_fetch(&(metrics->officers.serving), delta.serving, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&(metrics->officers.rest), delta.rest, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&(metrics->officers.idle), delta.idle, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&(metrics->officers.served), delta.served, __ATOMIC_RELAXED);
 }
 
 /**
- * Function closes the office, sets the office.is_open to closed state (0).
+ * The longest queue of the service in any shard.
  * 
  * @param shared_data Pointer to shared_data.
+ * @param service Index of the service <0, SERVICE_NUM).
+ * @return int Max number of customers in the queue.
  */
-void SM_OfficeClose(PTListDataPtr shared_data)
+static int SM_MetricsMaxQueue(PTListDataPtr shared_data, int service)
 {
-    // closing office
-    shared_data->office.is_open = 0;
+    int max_count = 0;
+    for (int s = 0; s < shared_data->office.shard_num; s++) {
+        if (SM_ShardArr[s].queue[service].max_count > max_count) {
+            max_count = SM_ShardArr[s].queue[service].max_count;
+        }
+    }
+    return max_count;
 }
 
 /**
- * Function destroys office data and semaphores.
+ * Prints metrics of the office - throughput and waiting/service times of every service. Should be called by 
+ * the init process after all the processes finished.
  * 
  * @param shared_data Pointer to shared_data.
- * @return int return(0) if the semaphore is destroyed correctly, otherwise returns(-1) 
-*/
-int SM_OfficeDestroy(PTListDataPtr shared_data)
+ * @param file Pointer to file where the metrics will be printed.
+ */
+void SM_MetricsPrint(PTListDataPtr shared_data, FILE *file)
 {
+    SM_Metrics *metrics = &(shared_data->metrics);
+    double sec = (nsec_now() - metrics->t_start) / 1e9;
 
-    // unset data
-    shared_data->office.is_open = 0;
-    shared_data->office.sem_1_count = 0;
-    shared_data->office.sem_2_count = 0;
-    shared_data->office.sem_3_count = 0;
+    uint64_t served = 0;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        served += metrics->wait[i].count;
+    }
 
-    // destroy semaphores
-    int err_check = 0;
-    err_check += sem_destroy(&(shared_data->office.sem_1));
-    err_check += sem_destroy(&(shared_data->office.sem_2));
-    err_check += sem_destroy(&(shared_data->office.sem_3));
+    fprintf(file, "policy: %s, topology: %s (%d shards), time: %.3f s, served: %lu, throughput: %.1f customers/s\n",
+            SM_PolicyNames[shared_data->office.policy], SM_TopologyNames[shared_data->office.topology], 
+            shared_data->office.shard_num, sec, (unsigned long)served, (sec > 0) ? served / sec : 0.0);
+
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        fprintf(file, "service %d: served %lu, rejected %lu, reneged %lu, max queue %d, wait mean %.3f p50 %.3f p99 %.3f max %.3f ms, service mean %.3f ms\n",
+                i + 1, (unsigned long)metrics->wait[i].count, (unsigned long)metrics->rejected[i], 
+                (unsigned long)metrics->reneged[i], SM_MetricsMaxQueue(shared_data, i),
+                MT_HistogramMean(&(metrics->wait[i])) / 1e6,
+                MT_HistogramPercentile(&(metrics->wait[i]), 50) / 1e6,
+                MT_HistogramPercentile(&(metrics->wait[i]), 99) / 1e6,
+                metrics->wait[i].max / 1e6,
+                MT_HistogramMean(&(metrics->service[i])) / 1e6);
+    }
 
-    return 0;
+    // drain time - closing to the last process gone home
+    uint64_t t_close = shared_data->office.t_close, t_last_home = metrics->t_last_home;
+    if (t_close != 0) {
+        fprintf(file, "drain: %.3f ms (closing to the last going home)\n", 
+                (t_last_home > t_close) ? (t_last_home - t_close) / 1e6 : 0.0);
+    }
+
+    fprintf(file, "wakeups: spin %lu, yield %lu, block %lu\n", (unsigned long)metrics->wake_spin,
+            (unsigned long)metrics->wake_yield, (unsigned long)metrics->wake_block);
 }
 
 /**
- * Function used by SM_OfficeServe function. Process which calls this function takes a break, is put to usleep.
+ * Prints metrics of the window since the previous snapshot (throughput, waiting times, queue length and number of
+ * officers) and takes a new snapshot. Used by the init process for periodic reports of a long running office.
  * 
  * @param shared_data Pointer to shared_data.
- * @param log_file Pointer to file where the data will be printed
- * @param process_id Process identifier, but it's not pid_t, it's an another indentification number.
- * @param max_break_time Maximum random time which the process will be put to sleep.
- * @return int return(0) if the break occured correctyl, otherwise returns(-1) 
+ * @param file Pointer to file where the metrics will be printed.
+ * @param prev (in/out) Snapshot of metrics at the start of the window, t_start is the time of the snapshot.
  */
-int SM_OfficeBreak(PTListDataPtr shared_data, FILE *log_file, int process_id, unsigned int max_break_time)
+void SM_MetricsWindow(PTListDataPtr shared_data, FILE *file, SM_Metrics *prev)
 {
-    char buffer[BUFFER_SIZE] = {0};
-    int err_value = 0;
-
-    // take a break
-    sprintf(buffer, "U %d: taking break", process_id);
-    err_value += SM_CounterPrint(shared_data, log_file, buffer);
+    SM_Metrics *metrics = &(shared_data->metrics);
+    uint64_t now = nsec_now();
+    double sec = (now - prev->t_start) / 1e9;
+
+    // waiting times of all the services in the window
+    MTHistogram cur, window, total;
+    memset(&total, 0, sizeof(total));
+    uint64_t rejected = 0, reneged = 0;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        uint64_t count = __atomic_load_n(&(metrics->rejected[i]), __ATOMIC_RELAXED);
+        rejected += count - prev->rejected[i];
+        prev->rejected[i] = count;
+        count = __atomic_load_n(&(metrics->reneged[i]), __ATOMIC_RELAXED);
+        reneged += count - prev->reneged[i];
+        prev->reneged[i] = count;
+
+        MT_HistogramSnapshot(&cur, &(metrics->wait[i]));
+        MT_HistogramDiff(&window, &cur, &(prev->wait[i]));
+        prev->wait[i] = cur;
+
+        total.count += window.count;
+        total.sum += window.sum;
+        total.max = (window.max > total.max) ? window.max : total.max;
+        for (unsigned int b = 0; b < MT_BUCKETS; b++) {
+            total.bucket[b] += window.bucket[b];
+        }
+    }
+    prev->t_start = now;
+
+    fprintf(file, "window %.3f s: served %lu, rejected %lu, reneged %lu, throughput %.1f customers/s, wait mean %.3f p50 %.3f p99 %.3f ms, waiting %d, officers %d\n",
+            sec, (unsigned long)total.count, (unsigned long)rejected, (unsigned long)reneged, (sec > 0) ? total.count / sec : 0.0,
+            MT_HistogramMean(&total) / 1e6,
+            MT_HistogramPercentile(&total, 50) / 1e6,
+            MT_HistogramPercentile(&total, 99) / 1e6,
+            SM_OfficeWaiting(shared_data), SM_OfficeOfficers(shared_data));
+    fflush(file);
+}
 
-    // sleep for random time
-    err_value += ran_msec_sleep(0, max_break_time);
 
-    // break is over
-    sprintf(buffer, "U %d: break finished", process_id);
-    err_value += SM_CounterPrint(shared_data, log_file, buffer);
 
-    // check if there was an error
-    if (err_value != 0) {
-        fprintf(stderr, "ERROR - SM_OfficeBreak - Error occured\n");
-        return -1;
+/**
+ * Prints time of an officer (or all of them) as text or JSON.
+ * 
+ * @param file Pointer to file where the time will be printed.
+ * @param json JSON object instead of a line of text.
+ * @param name Name of the row ("officer N" or "officers").
+ * @param time Time of the officer.
+ */
+static void SM_MetricsOfficerPrint(FILE *file, bool json, const char *name, const SM_OfficerTime *time)
+{
+    uint64_t total = time->serving + time->rest + time->idle;
+    double utilization = (total > 0) ? 100.0 * time->serving / total : 0.0;
+    if (json) {
+        fprintf(file, "{\"served\": %lu, \"serving_ms\": %.3f, \"break_ms\": %.3f, \"idle_ms\": %.3f, \"utilization\": %.2f}",
+                (unsigned long)time->served, time->serving / 1e6, time->rest / 1e6, time->idle / 1e6, utilization);
+    } else {
+        fprintf(file, "%s: served %lu, serving %.3f ms, break %.3f ms, idle %.3f ms, utilization %.1f %%\n", name,
+                (unsigned long)time->served, time->serving / 1e6, time->rest / 1e6, time->idle / 1e6, utilization);
     }
-
-    return 0;
 }
 
 /**
- * Process which calls this function serves a service to a customer process. (In form of messages).
- * This function should be called by officer type process. 
+ * Prints summary of the run - wall time, events per second, customers and waiting/service times of every service,
+ * time of every officer (serving, break, idle) and drain time after closing. Everything comes from counters in
+ * shared data, the log isn't read. Should be called by the init process after all the processes finished.
  * 
  * @param shared_data Pointer to shared_data.
- * @param log_file Pointer to file where the data will be printed
- * @param process_id Process identifier, but it's not pid_t, it's an another indentification number.
- * @param max_break_time maximum ammount of time which the process will be put to sleep if it takes a break.
- * @return int return(0) if the service was served correctly, otherwise returns(-1) 
+ * @param file Pointer to file where the report will be printed.
+ * @param format Format of the report ("text" - lines like SM_MetricsPrint(), "json" - one object).
+ * @return int returns(0) if the report was printed, returns(-1) if the format is unknown.
  */
-int SM_OfficeServe(PTListDataPtr shared_data, FILE *log_file, int process_id, unsigned int max_break_time)
+int SM_MetricsReport(PTListDataPtr shared_data, FILE *file, const char *format)
 {
-    // check what kind of service is requested
-    int type = 0, num = 0;
+    bool json = (strcmp(format, "json") == 0);
+    if (!json && strcmp(format, "text") != 0) {
+        DS_ERROR("ERROR - SM_MetricsReport, unknown format %s\n", format);
+        return -1;
+    }
 
-    // there should be mutex
-    // choosing the service which is going to be served
-    if (shared_data->office.sem_1_count > shared_data->office.sem_2_count) {
-        num = shared_data->office.sem_1_count;
-        type = 1;
-    }  else {
-        num = shared_data->office.sem_2_count;
-        type = 2;
-    }   
+    // [0] - whole run
+    SM_Metrics *metrics = &(shared_data->metrics);
+    double sec = (nsec_now() - metrics->t_start) / 1e9;
+    unsigned long events = shared_data->cnt.data - 1;
+    uint64_t t_close = shared_data->office.t_close, t_last_home = metrics->t_last_home;
+    double drain = (t_last_home > t_close) ? (t_last_home - t_close) / 1e6 : 0.0;
+    if (json) {
+        // drain time is null if the office wasn't closed
+        fprintf(file, "{\"time_s\": %.6f, \"events\": %lu, \"events_per_s\": %.1f, \"drain_ms\": ", 
+                sec, events, (sec > 0) ? events / sec : 0.0);
+        if (t_close != 0) {
+            fprintf(file, "%.3f", drain);
+        } else {
+            fprintf(file, "null");
+        }
+        fprintf(file, ",\n \"services\": [");
+    } else {
+        fprintf(file, "report: time %.3f s, events %lu, %.1f events/s", sec, events, (sec > 0) ? events / sec : 0.0);
+        if (t_close != 0) {
+            fprintf(file, ", drain %.3f ms", drain);
+        }
+        fprintf(file, "\n");
+    }
 
-    if (shared_data->office.sem_3_count > num) {
-        num = shared_data->office.sem_3_count;
-        type = 3;
+    // [1] - services
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        const MTHistogram *wait = &(metrics->wait[i]), *service = &(metrics->service[i]);
+        double w[4] = {MT_HistogramMean(wait) / 1e6, MT_HistogramPercentile(wait, 50) / 1e6,
+                       MT_HistogramPercentile(wait, 99) / 1e6, wait->max / 1e6};
+        double s[4] = {MT_HistogramMean(service) / 1e6, MT_HistogramPercentile(service, 50) / 1e6,
+                       MT_HistogramPercentile(service, 99) / 1e6, service->max / 1e6};
+        if (json) {
+            fprintf(file, "%s\n  {\"service\": %d, \"served\": %lu, \"rejected\": %lu, \"reneged\": %lu, \"max_queue\": %d, "
+                    "\"wait_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+                    "\"service_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}}",
+                    (i > 0) ? "," : "", i + 1, (unsigned long)wait->count, (unsigned long)metrics->rejected[i],
+                    (unsigned long)metrics->reneged[i], SM_MetricsMaxQueue(shared_data, i), 
+                    w[0], w[1], w[2], w[3], s[0], s[1], s[2], s[3]);
+        } else {
+            fprintf(file, "service %d: served %lu, rejected %lu, reneged %lu, max queue %d, "
+                    "wait mean %.3f p50 %.3f p99 %.3f max %.3f ms, service mean %.3f p50 %.3f p99 %.3f max %.3f ms\n",
+                    i + 1, (unsigned long)wait->count, (unsigned long)metrics->rejected[i],
+                    (unsigned long)metrics->reneged[i], SM_MetricsMaxQueue(shared_data, i),
+                    w[0], w[1], w[2], w[3], s[0], s[1], s[2], s[3]);
+        }
     }
 
-    // writing which service is going to be served
-    if (num > 0) {
-        switch (type) {
-            case 1: shared_data->office.sem_1_count--;
-                break;
-            case 2: shared_data->office.sem_2_count--;
-                break;
-            case 3: shared_data->office.sem_3_count--;
-                break;
-            default: break;
+    // [2] - officers, the ones over SM_METRICS_OFFICERS are only in the total
+    int officer_num = MIN(metrics->officer_num, SM_METRICS_OFFICERS);
+    if (json) {
+        fprintf(file, "],\n \"officers\": [");
+    }
+    for (int i = 0; i < officer_num; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "officer %d", i);
+        if (json) {
+            fprintf(file, "%s\n  ", (i > 0) ? "," : "");
         }
+        SM_MetricsOfficerPrint(file, json, name, &(metrics->officer[i]));
+    }
+    if (json) {
+        fprintf(file, "],\n \"officers_total\": ");
     }
-    // mutex should end here
+    SM_MetricsOfficerPrint(file, json, "officers", &(metrics->officers));
+    if (json) {
+        fprintf(file, "}\n");
+    }
+    return (fflush(file) == 0) ? 0 : -1;
+}
 
-    // if there is no one waiting, officer takes a break
-    if (num <= 0) {
-        SM_OfficeBreak(shared_data, log_file, process_id, max_break_time);
 
-    // officer serves the service
-    } else {
-        // calculate how long it takes to serve the service, interval <0, 10> milisec
-        unsigned int time = rand() % 11;    // this time will be sent to the customer process
-
-        // synchronise with targeted customer service front
-        switch (type) {
-            case 1: 
-                shared_data->office.timeout_1 = time;
-                sem_post(&(shared_data->office.sem_1));
-                break;
-            case 2: 
-                shared_data->office.timeout_2 = time;
-                sem_post(&(shared_data->office.sem_2));
-                break;
-            case 3: 
-                shared_data->office.timeout_3 = time;
-                sem_post(&(shared_data->office.sem_3));
-                break;
-            default: break;
-        }
-
-        // print which service is going to be served
-        char buffer[BUFFER_SIZE] = {0};
-        sprintf(buffer, "U %d: serving a service of type %d", process_id, type);
-        SM_CounterPrint(shared_data, log_file, buffer);
-    
-        // work on the service
-        msec_sleep(time);
-        
-        // print that service is done
-        sprintf(buffer, "U %d: service finished", process_id);
-        SM_CounterPrint(shared_data, log_file, buffer);
+
+/* - - - - - - - - - - - - */
+/*       SM_TIMELINE       */
+/* - - - - - - - - - - - - */
+// Timelines of customers and officers, built from printed events and exported by the init process at the end
+
+/* Customer and open interval of the calling process (process local), customers and officers are separate
+ * processes and an external client sends one customer at a time */
+static SM_CustomerRow SM_TlCustomer;
+static SM_IntervalRow SM_TlInterval;
+
+/**
+ * Starts recording timelines. Tables are in a separate shared memory which is reserved for the given number
+ * of rows, but only the pages with written rows take memory. This function must be called before creating 
+ * new processes.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param capacity Max number of rows of every table, rows over it are counted as dropped.
+ * @return int returns(0) if the timeline is recorded, returns(-1) if not.
+ */
+int SM_TimelineInit(PTListDataPtr shared_data, size_t capacity)
+{
+    SM_Timeline *timeline = &(shared_data->timeline);
+    if (timeline->enabled || capacity == 0) {
+        DS_ERROR("ERROR - SM_TimelineInit, timeline is already recorded or it's capacity is zero\n");
+        return -1;
+    }
+
+    SM_CustRowArr = SM_SharedMap(shared_data, ".tl.cust", capacity * sizeof(SM_CustomerRow), true);
+    SM_IntervalArr = SM_SharedMap(shared_data, ".tl.int", capacity * sizeof(SM_IntervalRow), true);
+    if (SM_CustRowArr == MAP_FAILED || SM_IntervalArr == MAP_FAILED) {
+        DS_ERROR("ERROR - SM_TimelineInit, mmap failed (SM_CustomerRow, SM_IntervalRow)\n");
+        return -1;
     }
 
+    timeline->capacity = capacity;
+    for (int t = 0; t < EV_TABLE_NUM; t++) {
+        timeline->rows[t] = 0;
+    }
+    timeline->enabled = true;
     return 0;
 }
 
 /**
- * Process which calls this function get's serverd a service which is requested by officer process. (In form of messages).
- * This function should be called by customer type process. 
+ * Records an event into the timeline of the calling process. A customer row is appended when the customer goes
+ * home, an interval row when the officer finishes the service or the break. Rows are taken by an atomic counter,
+ * so processes don't wait for each other.
  * 
  * @param shared_data Pointer to shared_data.
- * @param log_file Pointer to file where the data will be printed
- * @param process_id Process identifier, but it's not pid_t, it's an another indentification number.
- * @param type_of_service Type of service which is requested by the process.
- * @return int return(0) if the process was served correctly, otherwise returns(-1) 
+ * @param event Printed event.
+ * @param id Number of the customer or officer.
+ * @param arg Argument of the event (type of the service).
+ * @param now Time of the event, taken when it was printed.
  */
-int SM_OfficeService(PTListDataPtr shared_data, FILE *log_file, int process_id, int type_of_service)
+static void SM_TimelineEvent(PTListDataPtr shared_data, EVEvent event, int id, int arg, uint64_t now)
 {
-    // set-up message buffer for printing
-    char buffer[BUFFER_SIZE] = {0};
-    sprintf(buffer, "Z %d: called by office worker", process_id);
-
-    //go to the front of the queue
-    switch (type_of_service) {
-        case 1:
-            shared_data->office.sem_1_count++;
-            sem_wait(&(shared_data->office.sem_1));
-            SM_CounterPrint(shared_data, log_file, buffer);
+    SM_Timeline *timeline = &(shared_data->timeline);
+    SM_CustomerRow *cust = &SM_TlCustomer;
+    SM_IntervalRow *interval = &SM_TlInterval;
+    uint64_t row;
+
+    switch (event) {
+        // [0] - steps of the customer
+        case EV_Z_START:
+            cust->t_start = now;
+            cust->t_enter = cust->t_called = cust->t_home = EV_TIME_NONE;
+            cust->id = id;
+            cust->service = 0;
+            cust->outcome = EV_OUTCOME_CLOSED;
             break;
-        case 2:
-            shared_data->office.sem_2_count++;
-            sem_wait(&(shared_data->office.sem_2));
-            SM_CounterPrint(shared_data, log_file, buffer);
+        case EV_Z_ENTER:
+        case EV_Z_REJECTED:
+            cust->service = (uint8_t)arg;
+            cust->t_enter = (event == EV_Z_ENTER) ? now : EV_TIME_NONE;
+            cust->outcome = (event == EV_Z_ENTER) ? EV_OUTCOME_SERVED : EV_OUTCOME_REJECTED;
             break;
-        case 3:
-            shared_data->office.sem_3_count++;
-            sem_wait(&(shared_data->office.sem_3));
-            SM_CounterPrint(shared_data, log_file, buffer);
+        case EV_Z_CALLED:
+            cust->t_called = now;
+            break;
+        case EV_Z_RENEGED:
+            cust->outcome = EV_OUTCOME_RENEGED;
+            break;
+        case EV_Z_HOME:
+            cust->t_home = now;
+            row = __atomic_fetch_add(&(timeline->rows[EV_TABLE_CUSTOMERS]), 1, __ATOMIC_RELAXED);
+            if (row < timeline->capacity) {
+                SM_CustRowArr[row] = *cust;
+            }
             break;
-        default: 
-            fprintf(stderr, "ERROR - SM_OfficeService, wrong type of service\n");
-            return -1;
-    }
-
-    // print that customer is being served
-    //SM_CounterPrint(shared_data, log_file, buffer);
 
-    // wait for the service to be done depending on the time officer needs to serve the service
-    switch (type_of_service) {
-        case 1:
-            msec_sleep(shared_data->office.timeout_1);
+        // [1] - intervals of the officer
+        case EV_U_SERVING:
+        case EV_U_BREAK:
+            interval->t_begin = now;
+            interval->officer = id;
+            interval->kind = (event == EV_U_SERVING) ? EV_INTERVAL_SERVING : EV_INTERVAL_BREAK;
+            interval->service = (event == EV_U_SERVING) ? (uint8_t)arg : 0;
             break;
-        case 2: 
-            msec_sleep(shared_data->office.timeout_2);
+        case EV_U_SERVED:
+        case EV_U_BREAK_END:
+            interval->t_end = now;
+            row = __atomic_fetch_add(&(timeline->rows[EV_TABLE_INTERVALS]), 1, __ATOMIC_RELAXED);
+            if (row < timeline->capacity) {
+                SM_IntervalArr[row] = *interval;
+            }
             break;
-        case 3: 
-            msec_sleep(shared_data->office.timeout_3);
+        default:
             break;
-        default: break;
     }
+}
+
+/**
+ * Writes one column of the export - values of a field of all rows of a table, aligned to EV_EXPORT_ALIGN.
+ * 
+ * @param file File of the export.
+ * @param column Column descriptor, it's offset is set.
+ * @param rows Rows of the table.
+ * @param row_size Size of a row.
+ * @param row_num Number of rows.
+ * @param field Offset of the field in the row.
+ * @param relative Times are made relative to t_start (EV_TIME_NONE stays).
+ * @param t_start Start of the office.
+ * @return int returns(0) if the column was written, returns(-1) if not.
+ */
+static int SM_TimelineColumn(FILE *file, EVExportColumn *column, const char *rows, size_t row_size, size_t row_num,
+                             size_t field, bool relative, uint64_t t_start)
+{
+    // [0] - align the column
+    long pos = ftell(file);
+    static const char zeros[EV_EXPORT_ALIGN] = {0};
+    size_t pad = (EV_EXPORT_ALIGN - pos % EV_EXPORT_ALIGN) % EV_EXPORT_ALIGN;
+    if (pos < 0 || fwrite(zeros, 1, pad, file) != pad) {
+        return -1;
+    }
+    column->offset = (uint64_t)pos + pad;
+
+    // [1] - gather the values of the field
+    char *values = malloc(row_num * column->width + 1);
+    if (values == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < row_num; i++) {
+        const char *src = rows + i * row_size + field;
+        if (relative) {
+            uint64_t t;
+            memcpy(&t, src, sizeof(t));
+            t = (t == EV_TIME_NONE) ? EV_TIME_NONE : t - t_start;
+            memcpy(values + i * column->width, &t, sizeof(t));
+        } else {
+            memcpy(values + i * column->width, src, column->width);
+        }
+    }
+    int ret = (fwrite(values, column->width, row_num, file) == row_num) ? 0 : -1;
+    free(values);
+    return ret;
+}
+
+/**
+ * Writes recorded timelines into a columnar file - header, column descriptors and one array per column 
+ * (see EVExportHeader). Customers have columns id, service, outcome, t_start, t_enter, t_called, t_home and 
+ * wait (t_called - t_enter), intervals have officer, kind, service, t_begin and t_end. Should be called by 
+ * the init process after all the processes finished.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @param path Path of the export.
+ * @return int returns(0) if the export was written, returns(-1) if not.
+ */
+int SM_TimelineExport(PTListDataPtr shared_data, const char *path)
+{
+    SM_Timeline *timeline = &(shared_data->timeline);
+    if (!timeline->enabled) {
+        DS_ERROR("ERROR - SM_TimelineExport, timeline isn't recorded\n");
+        return -1;
+    }
+
+    // [0] - header, rows over the capacity were dropped
+    EVExportHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EV_EXPORT_MAGIC, sizeof(header.magic));
+    header.version = EV_EXPORT_VERSION;
+    header.dropped = 0;
+    for (int t = 0; t < EV_TABLE_NUM; t++) {
+        header.rows[t] = MIN(timeline->rows[t], timeline->capacity);
+        header.dropped += timeline->rows[t] - header.rows[t];
+    }
+    header.t_start = shared_data->metrics.t_start;
+
+    // waits are computed here, so every column is a field of a row
+    size_t cust_num = header.rows[EV_TABLE_CUSTOMERS];
+    uint64_t *wait = malloc((cust_num + 1) * sizeof(uint64_t));
+    if (wait == NULL) {
+        DS_ERROR("ERROR - SM_TimelineExport, malloc failed\n");
+        return -1;
+    }
+    for (size_t i = 0; i < cust_num; i++) {
+        SM_CustomerRow *row = &(SM_CustRowArr[i]);
+        wait[i] = (row->t_called == EV_TIME_NONE || row->t_enter == EV_TIME_NONE) ? EV_TIME_NONE : row->t_called - row->t_enter;
+    }
+
+    // [1] - columns (table, name, rows, field, width, field is a time)
+    #define SM_COLUMN(table, name, arr, type, field, rel) \
+        {table, name, (const char *)(arr), sizeof(type), offsetof(type, field), sizeof(((type *)0)->field), rel}
+    const struct {
+        uint32_t table;
+        const char *name;
+        const char *rows;
+        size_t row_size;
+        size_t field;
+        uint32_t width;
+        bool relative;
+    } columns[] = {
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "id", SM_CustRowArr, SM_CustomerRow, id, false),
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "service", SM_CustRowArr, SM_CustomerRow, service, false),
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "outcome", SM_CustRowArr, SM_CustomerRow, outcome, false),
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "t_start", SM_CustRowArr, SM_CustomerRow, t_start, true),
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "t_enter", SM_CustRowArr, SM_CustomerRow, t_enter, true),
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "t_called", SM_CustRowArr, SM_CustomerRow, t_called, true),
+        SM_COLUMN(EV_TABLE_CUSTOMERS, "t_home", SM_CustRowArr, SM_CustomerRow, t_home, true),
+        {EV_TABLE_CUSTOMERS, "wait", (const char *)wait, sizeof(uint64_t), 0, sizeof(uint64_t), false},
+        SM_COLUMN(EV_TABLE_INTERVALS, "officer", SM_IntervalArr, SM_IntervalRow, officer, false),
+        SM_COLUMN(EV_TABLE_INTERVALS, "kind", SM_IntervalArr, SM_IntervalRow, kind, false),
+        SM_COLUMN(EV_TABLE_INTERVALS, "service", SM_IntervalArr, SM_IntervalRow, service, false),
+        SM_COLUMN(EV_TABLE_INTERVALS, "t_begin", SM_IntervalArr, SM_IntervalRow, t_begin, true),
+        SM_COLUMN(EV_TABLE_INTERVALS, "t_end", SM_IntervalArr, SM_IntervalRow, t_end, true),
+    };
+    #undef SM_COLUMN
+    const uint32_t column_num = sizeof(columns) / sizeof(columns[0]);
+    header.column_num = column_num;
+    EVExportColumn desc[sizeof(columns) / sizeof(columns[0])];
+    memset(desc, 0, sizeof(desc));
+
+    // [2] - header and descriptors are written again when offsets of the columns are known
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        DS_ERROR("ERROR - SM_TimelineExport, file %s can't be opened\n", path);
+        free(wait);
+        return -1;
+    }
+    int err_check = (fwrite(&header, sizeof(header), 1, file) != 1) + (fwrite(desc, sizeof(desc), 1, file) != 1);
+    for (uint32_t c = 0; c < column_num && err_check == 0; c++) {
+        snprintf(desc[c].name, EV_EXPORT_NAME_SIZE, "%s", columns[c].name);
+        desc[c].table = columns[c].table;
+        desc[c].width = columns[c].width;
+        err_check += SM_TimelineColumn(file, &(desc[c]), columns[c].rows, columns[c].row_size, header.rows[columns[c].table],
+                                       columns[c].field, columns[c].relative, header.t_start) != 0;
+    }
+    if (err_check == 0) {
+        err_check += (fseek(file, 0, SEEK_SET) != 0);
+        err_check += (fwrite(&header, sizeof(header), 1, file) != 1) + (fwrite(desc, sizeof(desc), 1, file) != 1);
+    }
+    err_check += (fclose(file) != 0);
+    free(wait);
 
+    if (err_check != 0) {
+        DS_ERROR("ERROR - SM_TimelineExport, file %s can't be written\n", path);
+        return -1;
+    }
     return 0;
 }
 
+/**
+ * Stops recording timelines and destroys their tables.
+ * 
+ * @param shared_data Pointer to shared_data.
+ * @return int returns(0) if the tables were destroyed, returns(-1) if not.
+ */
+int SM_TimelineDestroy(PTListDataPtr shared_data)
+{
+    SM_Timeline *timeline = &(shared_data->timeline);
+    if (!timeline->enabled) {
+        return 0;
+    }
+
+    int err_check = 0;
+    err_check += SM_SharedUnmap(shared_data, ".tl.cust", SM_CustRowArr, timeline->capacity * sizeof(SM_CustomerRow), true);
+    err_check += SM_SharedUnmap(shared_data, ".tl.int", SM_IntervalArr, timeline->capacity * sizeof(SM_IntervalRow), true);
+    SM_CustRowArr = NULL;
+    SM_IntervalArr = NULL;
+    timeline->enabled = false;
+    return (err_check == 0) ? 0 : -1;
+}
+
 
 
 /* - - - - - - - - - - */
@@ -652,16 +3295,27 @@ int SM_OfficeService(PTListDataPtr shared_data, FILE *log_file, int process_id,
 // functions which put process to sleep state
 
 /**
- * Makes process sleep for n amount of miliseconds, implemented through usleep()
+ * Makes process sleep for n amount of miliseconds, implemented through nsec_sleep_until(), so it isn't
+ * cut short by signals
  * 
  * @param msec an amount of miliseconds process will sleep
  * @return int return(0) if the sleep functioned correctly, otherwise returns(-1)  
  */
 int msec_sleep(long msec)
 {
-    int res = -1;
-    res = usleep(1000 * msec);
-    return res;
+    return nsec_sleep_until(nsec_now() + (uint64_t)msec * 1000000ULL);
+}
+
+/**
+ * Makes process sleep for n amount of microseconds, implemented through nsec_sleep_until(), so it isn't
+ * cut short by signals
+ * 
+ * @param usec an amount of microseconds process will sleep
+ * @return int return(0) if the sleep functioned correctly, otherwise returns(-1)  
+ */
+int usec_sleep(long usec)
+{
+    return nsec_sleep_until(nsec_now() + (uint64_t)usec * 1000ULL);
 }
 
 /**
@@ -672,17 +3326,59 @@ int msec_sleep(long msec)
  * @return int return(0) if the sleep functioned correctly, otherwise returns(-1)  
  */
 int ran_msec_sleep(int min_msec, int max_msec)
+{
+    // sleeping for random amount of miliseconds
+    return msec_sleep(ran_msec(min_msec, max_msec));
+}
+
+/**
+ * Returns random amount of miliseconds in interval <min_msec, max_msec>, every process has it's own seed.
+ * 
+ * @param min_msec a minimum amount of miliseconds
+ * @param max_msec a maximum amount of miliseconds
+ * @return long random amount of miliseconds
+ */
+long ran_msec(int min_msec, int max_msec)
 {
     // initialising random seed
-    static bool init = false;
-    if (init == 0) {
+    static pid_t init = 0;
+    if (init != getpid()) {
         srand(getpid());
-        init = true;
+        init = getpid();
     }
 
     // generating random number
-    long msec = (rand() % (max_msec - min_msec + 1)) + min_msec;
+    return (rand() % (max_msec - min_msec + 1)) + min_msec;
+}
 
-    // sleeping for random amount of miliseconds
-    return msec_sleep(msec);
-}
\ No newline at end of file
+/**
+ * Returns monotonic time in nanoseconds, used for absolute deadlines which don't drift.
+ * 
+ * @return uint64_t monotonic time in nanoseconds
+ */
+uint64_t nsec_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Makes process sleep until the given monotonic time, returns immediately if the time already passed.
+ * 
+ * @param deadline monotonic time in nanoseconds (see nsec_now())
+ * @return int return(0) if the sleep functioned correctly, otherwise returns(-1)  
+ */
+int nsec_sleep_until(uint64_t deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000ULL;
+    ts.tv_nsec = deadline % 1000000000ULL;
+
+    // sleep again if the sleep was interrupted by a signal
+    int res;
+    PT_ProcessSleep(true);
+    while ((res = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR);
+    PT_ProcessSleep(false);
+    return (res == 0) ? 0 : -1;
+}
@@ -13,9 +13,13 @@
 // standart libraries
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
 
 // linux libs
 #include <unistd.h>
@@ -25,6 +29,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <sched.h>
 
 // linux semaphore libs
 #include <semaphore.h>
@@ -34,6 +39,13 @@
 // remove later maybe
 #include <sys/shm.h>
 
+// project modules
+#include "ptable.h"
+#include "distribution.h"
+#include "metrics.h"
+#include "event_log.h"
+#include "log_writer.h"
+
 
 
 /* - - - - - - - - - - - -*/
@@ -43,6 +55,16 @@
 /* Constant macros */
 #define KEY_MAX_SIZE 1000   // process's table (key max length
 #define BUFFER_SIZE 200     // size of the print buffer
+#define SERVICE_NUM 3       // number of service types in the office
+#define PT_TAG_MAX 8        // max number of tags in the process table
+#define PT_SEG_MAX 16       // max number of segments of a tag, every next segment is twice as big
+#define PT_SEG_NAME_SIZE 64 // size of the name of a shared segment
+#define SM_SPIN_MAX_NS 50000ULL // customers whose expected wait is longer don't spin and block right away
+#define SM_SPIN_BACKOFF 64      // max number of cpu pauses between two tries of a spinning customer
+#define SM_TL_ROWS 4194304      // default number of rows of timeline tables, only pages with written rows take memory
+#define SM_YIELD_TRIES 4        // number of sched_yield() tries after spinning, before blocking
+#define SM_EWMA_SHIFT 3         // weight of a new sample of the waiting time is 1/2^SM_EWMA_SHIFT
+#define SM_METRICS_OFFICERS 256 // number of officers with their own time in metrics, the rest is only in the total
 
 /* Macro functions */
 #define is_init_pid(list) (list->init_pid.pid == getpid())      // check if the process is the one that initialized the process table
@@ -59,6 +81,8 @@ typedef enum {
     DEAD = 0,
     // process is running
     RUNNING = 1,
+    // process is blocked in one of the sleep functions or waits on a semaphore
+    SLEEPING = 2,
 } PTProcessState;
 
 /*States of a semaphore */
@@ -69,6 +93,34 @@ typedef enum {
     SEM_INIT = 1,
 } PTSemaphoreState;
 
+/* Dispatch policies of officers, decide which service is served next */
+typedef enum {
+    // service with the longest queue, ties are broken in round robin order
+    SM_POLICY_LONGEST = 0,
+    // service whose first customer waits the longest (FIFO across all queues)
+    SM_POLICY_OLDEST = 1,
+    // services take turns
+    SM_POLICY_ROUND_ROBIN = 2,
+    // weighted fair queueing, services get served time proportional to their weights
+    SM_POLICY_WFQ = 3,
+    // service with the shortest expected service time
+    SM_POLICY_SESF = 4,
+    // number of policies
+    SM_POLICY_NUM = 5,
+} SMDispatchPolicy;
+
+/* Topologies of the office, decide in which shard of the office a customer waits */
+typedef enum {
+    // one shard shared by all officers
+    SM_TOPOLOGY_GLOBAL = 0,
+    // shard is chosen by hash of the customer number
+    SM_TOPOLOGY_HASH = 1,
+    // shorter of two shards chosen by two hashes of the customer number (power of two choices)
+    SM_TOPOLOGY_P2C = 2,
+    // number of topologies
+    SM_TOPOLOGY_NUM = 3,
+} SMTopology;
+
 
 
 /* - - - - - - - - - - - - */
@@ -80,26 +132,175 @@ typedef struct SM_Counter {
     unsigned int data;
     PTSemaphoreState sem_state; 
     sem_t sem_1;
+    // format of the log (text lines or binary records)
+    EVFormat format;
+    // absolute path of the timestamp file of lines, empty if lines aren't timestamped
+    char ts_path[PATH_MAX];
+    // lines go through the log ring (separate shared memory) and the writer thread of the init process
+    bool ring;
+    // lines are copied into the mapped log file (every process maps it), bytes used and reserved in the file
+    bool map;
+    uint64_t map_used;
+    uint64_t map_size;
+    // absolute path of the mapped log file
+    char map_path[PATH_MAX];
 } SM_Counter;
 
+/* Customer in the office, indexed by customer's process number */
+typedef struct SM_Customer {
+    // customer waits on this semaphore until he is called by an officer
+    sem_t sem;
+    // type of the requested service <1, SERVICE_NUM>
+    int service;
+    // shard in which the customer waits
+    int shard;
+    // next and previous customer in the queue (-1 if the customer is the last/first one)
+    int next;
+    int prev;
+    // customer is in a queue, cleared by the officer who calls him or by the customer who leaves
+    bool queued;
+    // next free record of external clients (-1 if this is the last one)
+    int next_free;
+    // service time in microseconds, set by the officer who called the customer
+    unsigned int timeout;
+    // time when the customer entered the queue (nsec_now())
+    uint64_t t_enter;
+} SM_Customer;
+
+/* FIFO queue of customers waiting for one service */
+typedef struct SM_Queue {
+    // first and last customer in the queue (-1 if the queue is empty)
+    int head;
+    int tail;
+    // number of customers in the queue, at most queue_cap of the service
+    int count;
+    // the most customers which were in the queue at once
+    int max_count;
+    // virtual finish time of the queue (weighted fair queueing)
+    double finish;
+    // moving average of recent waits for the call (ns), decides how long new customers spin
+    uint64_t wait_ewma;
+} SM_Queue;
+
+/* Shard of the office - queues of all services with their own mutex, every officer has a home shard */
+typedef struct SM_Shard {
+    // mutex guarding the queues of the shard
+    sem_t mutex;
+    // last served service (round robin, tie breaking) and virtual time (weighted fair queueing)
+    int last_service;
+    double vtime;
+    // queues of services 1, 2 and 3
+    SM_Queue queue[SERVICE_NUM];
+} SM_Shard;
+
 /* Shared data if a o process used by Office functions */
 typedef struct SM_Office {
-    // office is open or closed (0 - closed, 1 - open)
+    // office is open or closed (0 - closed, 1 - open), changed only when all shards are locked
     int is_open; 
-    // service 1
-    sem_t sem_1;
-    int sem_1_count;
-    unsigned int timeout_1;
-    // service 2
-    sem_t sem_2;
-    int sem_2_count;
-    unsigned int timeout_2;
-    // service 3
-    sem_t sem_3;
-    int sem_3_count;
-    unsigned int timeout_3;
+    // close event - posted once by closing, every process which takes it posts it again (latch)
+    sem_t closed;
+    // time of closing (nsec_now()), (0) while the office is open
+    uint64_t t_close;
+    // seed of officer's random number generators
+    unsigned long seed;
+    // dispatch policy of the officers
+    SMDispatchPolicy policy;
+    // weights of services (weighted fair queueing)
+    double weight[SERVICE_NUM];
+    // number of officers which are working (autoscaling)
+    int officers;
+    // topology of the office and number of it's shards (separate shared memory, mapped by every process)
+    SMTopology topology;
+    int shard_num;
+    // service time distributions of services 1, 2 and 3
+    DSService service[SERVICE_NUM];
+    // number of customer records (separate shared memory, mapped by every process), records of external 
+    // clients are after the records of customers
+    int cust_cap;
+    int client_cap;
+    // free-list of records of external clients, same encoding as free_head of PTListTag
+    uint64_t client_free;
+    // number of the next external client
+    int client_id;
+    // absolute path of the log file, external clients append to it
+    char log_path[PATH_MAX];
+    // max number of customers waiting for a service in one shard, (0) means unlimited
+    int queue_cap[SERVICE_NUM];
+    // customers who wait longer leave the queue (nanoseconds), (0) means they wait forever
+    uint64_t patience;
 } SM_Office;
 
+/* Time of an officer (or all of them) in nanoseconds, split by what he was doing */
+typedef struct SM_OfficerTime {
+    // serving a service -> service finished, taking break -> break finished, the rest until going home
+    uint64_t serving;
+    uint64_t rest;
+    uint64_t idle;
+    // number of served customers
+    uint64_t served;
+} SM_OfficerTime;
+
+/* Shared data with metrics of the office, recorded during the run and printed by the init process */
+typedef struct SM_Metrics {
+    // time when the metrics started (nsec_now())
+    uint64_t t_start;
+    // waiting time of customers (entering -> called) in nanoseconds
+    MTHistogram wait[SERVICE_NUM];
+    // service time in nanoseconds
+    MTHistogram service[SERVICE_NUM];
+    // customers turned away by a full queue and customers who left the queue before they were called
+    uint64_t rejected[SERVICE_NUM];
+    uint64_t reneged[SERVICE_NUM];
+    // time when the last process went home (nsec_now())
+    uint64_t t_last_home;
+    // how customers were woken up by the call (spinning, yielding, blocked on the semaphore)
+    uint64_t wake_spin;
+    uint64_t wake_yield;
+    uint64_t wake_block;
+    // time of the first SM_METRICS_OFFICERS officers (every one writes only his own) and of all of them
+    SM_OfficerTime officer[SM_METRICS_OFFICERS];
+    SM_OfficerTime officers;
+    // number of officers by their numbers (highest number + 1)
+    int officer_num;
+} SM_Metrics;
+
+
+
+/* Timeline of one customer (nsec_now() times, EV_TIME_NONE if the customer didn't get to the step) */
+typedef struct SM_CustomerRow {
+    uint64_t t_start;
+    uint64_t t_enter;
+    uint64_t t_called;
+    uint64_t t_home;
+    int32_t id;
+    // requested service, (0) if the customer didn't come to the office while it was open
+    uint8_t service;
+    // EVOutcome
+    uint8_t outcome;
+} SM_CustomerRow;
+
+/* Interval of work or break of one officer (nsec_now() times) */
+typedef struct SM_IntervalRow {
+    uint64_t t_begin;
+    uint64_t t_end;
+    int32_t officer;
+    // EVInterval
+    uint8_t kind;
+    // served service, (0) for breaks
+    uint8_t service;
+} SM_IntervalRow;
+
+/* Shared data of the timeline - rows are appended by processes when a customer goes home or an interval ends,
+ * tables live in a separate shared memory */
+typedef struct SM_Timeline {
+    // timeline is recorded (SM_TimelineInit())
+    bool enabled;
+    // capacity of every table in rows
+    uint64_t capacity;
+    // number of rows taken in every table (EVTable), it can be higher than the capacity
+    uint64_t rows[EV_TABLE_NUM];
+} SM_Timeline;
+
 
 
 /* - - - - - - - - - - - */
@@ -114,26 +315,40 @@ typedef struct PTProcess {
     pid_t ppid;
     // process state
     unsigned int state;
+    // next slot in the free-list of the tag (-1 if this is the last one)
+    int next_free;
 } *PTProcessPtr;
 
 /* Tag of a process, which is in a linked list of tags. */
 typedef struct PTListTag {
     // the key/tag of a process
     char key[KEY_MAX_SIZE];
-    // pointer to tag's data
+    // pointer to tag's data (first segment, mapped before fork)
     struct PTProcess *p_arr;
+    // number of slots in the first segment (capacity of the tag given to PT_InitCapacity())
+    size_t p_base;
+    // number of segments of the tag, segments 1.. are named shared memory (see PT_Slot())
+    unsigned int seg_num;
+    // number of slots in all the segments
+    unsigned int p_cap;
     // number of processes in the tag
     unsigned int p_num;
     // number of sleeping processes
     unsigned int p_sleep;
     // number of running processes
     unsigned int p_run;
+    // free-list of slots of dead processes - lower 32 bits are (slot + 1) of the first slot (0 if the list is empty),
+    // upper 32 bits are a version which changes with every push and pop (ABA problem)
+    uint64_t free_head;
 } *PTListTagPtr;
 
 /* Shared data of a process in process table -> added by user */
 typedef struct PTListData {
+    char name[PT_SEG_NAME_SIZE];       // name of the shared memory (empty if it's anonymous)
     struct SM_Counter cnt;             // basic counter used by multiple processes
     struct SM_Office office;           // office data needed for the given task (office)
+    struct SM_Metrics metrics;         // metrics of the office
+    struct SM_Timeline timeline;       // timelines of customers and officers for the export
 } *PTListDataPtr;
 
 /**
@@ -146,7 +361,7 @@ typedef struct PTList {
     struct PTListData *shared_data;
     // max number of tags in the list
     size_t t_size;
-    // max number of processes in one tag
+    // max number of processes in the first segment of a tag (tags have their own capacities, see p_base)
     size_t p_size;
     // number of tags in the list
     unsigned int t_num;
@@ -154,6 +369,9 @@ typedef struct PTList {
     struct PTProcess init_pid;
 } PTList;
 
+/* Number of the first external client, clients are numbered from it so they don't collide with customers */
+#define SM_CLIENT_ID_BASE 1000000
+
 
 
 /* - - - - - - - - - - - */
@@ -163,6 +381,18 @@ typedef struct PTList {
 /* Initiates the process table and returns pointer to it */
 extern PTList* PT_Init(size_t t_size, size_t p_size); 
 
+/* Initiates the process table with own capacity of every tag and returns pointer to it */
+extern PTList* PT_InitCapacity(size_t t_size, char *keys[], const size_t p_sizes[]);
+
+/* Initiates the process table with shared data in named shared memory, other programs can attach to it */
+extern PTList* PT_InitNamed(size_t t_size, char *keys[], const size_t p_sizes[], const char *name);
+
+/* Returns number of bytes of shared memory used by the process table */
+extern size_t PT_Footprint(PTList *list);
+
+/* Returns slot of a process, attaches the segment of the slot if it isn't mapped yet */
+extern PTProcessPtr PT_Slot(PTList *list, PTListTagPtr tag_ptr, unsigned int slot);
+
 /* Cleares all memory and kills all the child processes */
 extern int PT_Destroy(PTList **list); 
 
@@ -175,7 +405,22 @@ extern int PT_Destroy(PTList **list);
 extern int PT_ProcessSearch(PTList *list, pid_t pid, char *tag, int *tag_num, int *pro_num);
 
 /* Creates process in process table with no data */
-extern void PT_ProcessCreate(PTList *list, char *tag);
+extern pid_t PT_ProcessCreate(PTList *list, char *tag);
+
+/* Marks terminated process as dead, so it's slot can be reused */
+extern int PT_ProcessReap(PTList *list, pid_t pid);
+
+/* Waits for all child processes and reaps them */
+extern int PT_ProcessWaitAll(PTList *list);
+
+/* Returns number of living processes in the tag */
+extern unsigned int PT_ProcessCount(PTList *list, char *tag);
+
+/* Returns slot of the calling process in it's tag */
+extern int PT_ProcessSlot(void);
+
+/* Marks the calling process as sleeping or running */
+extern void PT_ProcessSleep(bool sleeping);
 
 /* Checks if process is in the given tag */
 extern int PT_IsTag(PTList *list, char *tag);
@@ -191,6 +436,27 @@ int SM_CounterInit(PTListDataPtr shared_data);
 /* print counter-data and increments it */
 int SM_CounterPrint(PTListDataPtr shared_data, FILE *file, char *message);
 
+/* set format of the log ("text", "binary") */
+int SM_CounterSetFormat(PTListDataPtr shared_data, const char *format);
+
+/* print an event with counter-data in the format of the log and increments it */
+int SM_CounterEvent(PTListDataPtr shared_data, FILE *file, EVEvent event, int id, int arg);
+
+/* write monotonic time of every line into a side file */
+int SM_CounterSetTimestamps(PTListDataPtr shared_data, const char *path);
+
+/* lines are written into the log by a writer thread ("uring[,DEPTH]", "pwrite") */
+int SM_CounterSetWriter(PTListDataPtr shared_data, FILE *file, const char *spec);
+
+/* wait until the writer writes the whole log and stop it */
+int SM_CounterWriterStop(PTListDataPtr shared_data, FILE *stats);
+
+/* lines are copied into the log file mapped into memory, reserve bytes are allocated up front */
+int SM_CounterSetMap(PTListDataPtr shared_data, const char *path, size_t reserve);
+
+/* unmap the log file and truncate it to it's real length */
+int SM_CounterMapStop(PTListDataPtr shared_data);
+
 /* destroy semaphores in counter*/
 int SM_CounterDestroy(PTListDataPtr shared_data);
 
@@ -200,7 +466,41 @@ int SM_CounterDestroy(PTListDataPtr shared_data);
 /* - - - - - - - - - - - - - - - - - - */
 
 /* initialize office data */
-int SM_OfficeInit(PTListDataPtr shared_data);
+int SM_OfficeInit(PTListDataPtr shared_data, int customer_num, unsigned long seed);
+
+/* set dispatch policy of officers */
+int SM_OfficeSetPolicy(PTListDataPtr shared_data, const char *name);
+
+/* set weights of services used by weighted fair queueing */
+int SM_OfficeSetWeights(PTListDataPtr shared_data, const char *weights);
+
+/* set topology of the office and number of it's shards */
+int SM_OfficeSetTopology(PTListDataPtr shared_data, const char *name, int shard_num);
+
+/* set service time distribution of a service */
+int SM_OfficeSetService(PTListDataPtr shared_data, int type_of_service, const char *spec);
+
+/* set number of records of external clients */
+int SM_OfficeSetClients(PTListDataPtr shared_data, int client_num);
+
+/* set max lengths of the queues of services */
+int SM_OfficeSetQueueCap(PTListDataPtr shared_data, const char *caps);
+/* set how long customers wait before they leave the queue */
+int SM_OfficeSetPatience(PTListDataPtr shared_data, unsigned int patience_ms);
+/* set log file of the office, external clients append to it */
+int SM_OfficeSetLog(PTListDataPtr shared_data, const char *path);
+
+/* attach named office from another program */
+PTListDataPtr SM_OfficeAttach(const char *name);
+
+/* detach named office */
+int SM_OfficeDetach(PTListDataPtr shared_data);
+
+/* take a free record of an external client */
+int SM_OfficeRecordAcquire(PTListDataPtr shared_data);
+
+/* return record of an external client */
+void SM_OfficeRecordRelease(PTListDataPtr shared_data, int record);
 
 /* destroy office data */
 int SM_OfficeDestroy(PTListDataPtr shared_data);
@@ -208,14 +508,67 @@ int SM_OfficeDestroy(PTListDataPtr shared_data);
 /* set office to close-state*/
 void SM_OfficeClose(PTListDataPtr shared_data);
 
+/* wait until the office closes or the time runs out */
+int SM_OfficeWaitClose(PTListDataPtr shared_data, long msec);
+/* process prints that it's going home */
+int SM_OfficeGoHome(PTListDataPtr shared_data, FILE *log_file, const char *role, int process_id);
 /* officer takes a break -> used by serve*/
 int SM_OfficeBreak(PTListDataPtr shared_data, FILE *log_file, int process_id, unsigned int max_break_time);
 
 /* officer servers a servis */
 int SM_OfficeServe(PTListDataPtr shared_data, FILE *log_file, int process_id, unsigned int max_break_time);
 
+/* officer calls the next customer without waking him up */
+int SM_OfficeCall(PTListDataPtr shared_data, int process_id);
+
+/* customer enters the office without waiting for the service */
+int SM_OfficeEnter(PTListDataPtr shared_data, FILE *log_file, int process_id, int record, int type_of_service);
+
 /* customer gets service he desires*/
-int SM_OfficeService(PTListDataPtr shared_data, FILE *log_file, int process_id, int type_of_service);
+int SM_OfficeService(PTListDataPtr shared_data, FILE *log_file, int process_id, int record, int type_of_service);
+
+/* number of customers waiting in all queues */
+int SM_OfficeWaiting(PTListDataPtr shared_data);
+
+/* officer starts working in the office */
+void SM_OfficeHire(PTListDataPtr shared_data);
+
+/* idle officer leaves the office if there are more than min_officers officers */
+int SM_OfficeRetire(PTListDataPtr shared_data, int min_officers);
+
+/* number of officers working in the office */
+int SM_OfficeOfficers(PTListDataPtr shared_data);
+
+/* number of bytes of shared memory used by the office */
+size_t SM_OfficeFootprint(PTListDataPtr shared_data);
+
+
+/* - - - - - - - - - - - - - - - - - - */
+/*         SM_METRICS FUNCTIONS        */
+/* - - - - - - - - - - - - - - - - - - */
+
+/* prints metrics of the office */
+void SM_MetricsPrint(PTListDataPtr shared_data, FILE *file);
+
+/* prints metrics of the window since the previous snapshot and takes a new one */
+void SM_MetricsWindow(PTListDataPtr shared_data, FILE *file, SM_Metrics *prev);
+
+/* prints summary of the run ("text", "json") */
+int SM_MetricsReport(PTListDataPtr shared_data, FILE *file, const char *format);
+
+
+/* - - - - - - - - - - - - - - - - - - */
+/*        SM_TIMELINE FUNCTIONS        */
+/* - - - - - - - - - - - - - - - - - - */
+
+/* start recording timelines of customers and officers */
+int SM_TimelineInit(PTListDataPtr shared_data, size_t capacity);
+
+/* write recorded timelines into a columnar file */
+int SM_TimelineExport(PTListDataPtr shared_data, const char *path);
+
+/* destroy recorded timelines */
+int SM_TimelineDestroy(PTListDataPtr shared_data);
 
 
 /* - - - - - - - - - - - - - - - - - */
@@ -247,5 +600,16 @@ extern void PT_PrintList(PTList *list);
 /* Makes process sleep for n amount of miliseconds */
 int msec_sleep(long msec);
 
+/* Makes process sleep for n amount of microseconds */
+int usec_sleep(long usec);
+
 /* Makes process sleep for random amount of time */
 int ran_msec_sleep(int min_msec, int max_msec);
+/* Returns random amount of miliseconds */
+long ran_msec(int min_msec, int max_msec);
+
+/* Returns monotonic time in nanoseconds */
+uint64_t nsec_now(void);
+
+/* Makes process sleep until the given monotonic time in nanoseconds */
+int nsec_sleep_until(uint64_t deadline);
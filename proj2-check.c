@@ -0,0 +1,1020 @@
+/**
+ * @file proj2-check.c
+ * @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ * @brief Checks format of proj2.out like testing/kontrola-vystupu.py, but the log is memory mapped and lines are
+ *        parsed by hand (newlines are found 16 bytes at a time), so even logs with 100M lines are checked in seconds.
+ *        With -s the order of lines is checked too - every customer and officer goes through a state machine.
+ *        Big logs are split into chunks checked by more threads, summaries of the chunks are merged in order.
+ * @date 2023-04-24
+ */
+
+/* - - - - - - - - - - -*/
+/*      DEFINITIONS     */
+/* - - - - - - - - - - -*/
+
+/* libraries */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* constants */
+#define PROGRAM_NAME "proj2-check.c"
+#define CK_READ_CHUNK 65536     // size of a chunk when the log is read from a pipe
+#define CK_ACTORS_INIT 1024     // initial size of the hash table of actors (power of 2)
+#define CK_REPORT_MAX 20        // max number of reported semantic errors, the rest is only counted
+#define CK_SERVICE_NUM 3        // number of services of the office
+#define CK_THREADS_MAX 256      // max number of threads of the parallel check
+#define CK_BENCH_RUNS 3         // the best of so many runs is reported by the benchmark
+#define CK_S_BAD CK_STATE_NUM   // state after a transition which isn't allowed (summaries of chunks)
+
+/* Forms of lines in the log */
+typedef enum {
+    CK_Z_START = 0,     // Z n: started
+    CK_Z_ENTER,         // Z n: entering office for a service k
+    CK_Z_CALLED,        // Z n: called by office worker
+    CK_Z_REJECTED,      // Z n: rejected from a service k
+    CK_Z_RENEGED,       // Z n: leaving the queue of a service k
+    CK_Z_HOME,          // Z n: going home
+    CK_U_START,         // U n: started
+    CK_U_HOME,          // U n: going home
+    CK_U_BREAK,         // U n: taking break
+    CK_U_BREAK_END,     // U n: break finished
+    CK_U_SERVING,       // U n: serving a service of type k
+    CK_U_SERVED,        // U n: service finished
+    CK_CLOSING,         // closing
+    CK_FORM_NUM,
+    CK_ERROR = -1,      // line doesn't match any form
+} CKForm;
+
+/* States of customers (Z) and officers (U) in the semantic check */
+typedef enum {
+    CK_S_NEW = 0,       // actor wasn't seen yet (empty slot of the hash table)
+    CK_S_STARTED,       // Z started
+    CK_S_QUEUED,        // Z entered the office
+    CK_S_CALLED,        // Z was called by an officer
+    CK_S_LEFT,          // Z was rejected or left the queue
+    CK_S_IDLE,          // U started or finished a service/break
+    CK_S_SERVING,       // U serves a customer
+    CK_S_BREAK,         // U takes a break
+    CK_S_HOME,          // actor went home
+    CK_STATE_NUM,
+} CKState;
+
+/* Parsed line of the log */
+typedef struct CKLine {
+    // form of the line
+    CKForm form;
+    // number of the line printed by the counter, number of the process (-1 for closing) and type of service (0 if none)
+    unsigned long counter;
+    unsigned long id;
+    int service;
+} CKLine;
+
+/* Text after "Z n: " or "U n: " of every form, forms with a service end with it's type <1, 3> */
+static const struct {
+    char role;
+    const char *text;
+    size_t len;
+    bool service;
+} CK_Forms[CK_FORM_NUM - 1] = {
+    {'Z', "started", 7, false},
+    {'Z', "entering office for a service ", 30, true},
+    {'Z', "called by office worker", 23, false},
+    {'Z', "rejected from a service ", 24, true},
+    {'Z', "leaving the queue of a service ", 31, true},
+    {'Z', "going home", 10, false},
+    {'U', "started", 7, false},
+    {'U', "going home", 10, false},
+    {'U', "taking break", 12, false},
+    {'U', "break finished", 14, false},
+    {'U', "serving a service of type ", 26, true},
+    {'U', "service finished", 16, false},
+};
+
+/* Next state of an actor after a line of the given form, missing transitions are CK_S_NEW (0) where no line
+   leads, so they are errors */
+static const uint8_t CK_Next[CK_STATE_NUM][CK_FORM_NUM] = {
+    [CK_S_NEW] = {[CK_Z_START] = CK_S_STARTED, [CK_U_START] = CK_S_IDLE},
+    [CK_S_STARTED] = {[CK_Z_ENTER] = CK_S_QUEUED, [CK_Z_REJECTED] = CK_S_LEFT, [CK_Z_HOME] = CK_S_HOME},
+    [CK_S_QUEUED] = {[CK_Z_CALLED] = CK_S_CALLED, [CK_Z_RENEGED] = CK_S_LEFT},
+    [CK_S_CALLED] = {[CK_Z_HOME] = CK_S_HOME},
+    [CK_S_LEFT] = {[CK_Z_HOME] = CK_S_HOME},
+    [CK_S_IDLE] = {[CK_U_SERVING] = CK_S_SERVING, [CK_U_BREAK] = CK_S_BREAK, [CK_U_HOME] = CK_S_HOME},
+    [CK_S_SERVING] = {[CK_U_SERVED] = CK_S_IDLE},
+    [CK_S_BREAK] = {[CK_U_BREAK_END] = CK_S_IDLE},
+};
+
+/* Names of states used in error messages */
+static const char *CK_StateNames[CK_STATE_NUM] = {
+    "not started", "started", "in a queue", "called", "turned away", "idle", "serving", "on a break", "gone home"
+};
+
+/* Customer or officer in the semantic check, key is 2 * id (+ 1 for officers) */
+typedef struct CKActor {
+    unsigned long key;
+    uint8_t state;
+    uint8_t service;
+} CKActor;
+
+/* State of the semantic check, memory grows with the number of actors, not with the number of lines */
+typedef struct CKSemantic {
+    // open addressing hash table of actors
+    CKActor *actor;
+    size_t cap;
+    size_t num;
+    // number of the previous line, the office was closed, officers serving a service who weren't matched by a called customer yet
+    unsigned long counter;
+    bool closed;
+    unsigned long serving[CK_SERVICE_NUM + 1];
+    // number of found errors
+    unsigned long errors;
+} CKSemantic;
+
+/* Call of a customer whose service isn't known in the chunk, because he entered the office in an earlier chunk */
+typedef struct CKCall {
+    unsigned long key;
+    // balances of services (servings - calls) in the chunk before the call and their minimum since the previous unknown call
+    long balance[CK_SERVICE_NUM + 1];
+    long low[CK_SERVICE_NUM + 1];
+} CKCall;
+
+/* Actor in a chunk - maps his state at the start of the chunk to his state at the end of it */
+typedef struct CKSummary {
+    unsigned long key;
+    bool used;
+    // service of the last entering in the chunk, (0) if he didn't enter
+    uint8_t service;
+    uint8_t next[CK_STATE_NUM];
+} CKSummary;
+
+/* Chunk of the log checked by one thread, chunks are merged in order */
+typedef struct CKChunk {
+    // lines of the chunk, the semantic check is done
+    const char *begin;
+    const char *end;
+    bool semantic;
+    // number of lines of every form and of wrong lines
+    unsigned long count[CK_FORM_NUM];
+    unsigned long format_errors;
+    // first and last line number, numbers inside the chunk follow each other
+    unsigned long first;
+    unsigned long last;
+    bool sequence;
+    // number of closings, line number of the first closing and of the last customer who came to the office
+    unsigned long closings;
+    unsigned long closing;
+    unsigned long came;
+    // hash table of actors
+    CKSummary *actor;
+    size_t cap;
+    size_t num;
+    // calls with unknown service, balances of services at the end of the chunk and their minimum since the last call
+    CKCall *call;
+    size_t call_num;
+    size_t call_cap;
+    long balance[CK_SERVICE_NUM + 1];
+    long low[CK_SERVICE_NUM + 1];
+    // memory ran out
+    bool failed;
+} CKChunk;
+
+/* functions */
+const char *CK_FindNewline(const char *ptr, const char *end);
+int CK_ParseLine(const char *ptr, const char *end, CKLine *line);
+const char *CK_Map(const char *path, size_t *size, bool *mapped);
+int CK_SemanticInit(CKSemantic *sem);
+void CK_SemanticLine(CKSemantic *sem, const CKLine *line, const char *ptr, const char *end);
+void CK_SemanticEnd(CKSemantic *sem);
+void CK_SemanticDestroy(CKSemantic *sem);
+int CK_Report(const unsigned long count[]);
+int CK_CheckSequential(const char *log, size_t size, bool semantic);
+int CK_CheckParallel(const char *log, size_t size, bool semantic, int threads, unsigned long count[]);
+int CK_Bench(const char *log, size_t size, bool semantic, int threads);
+
+
+
+/* - - - - - - - - - - -*/
+/*         MAIN         */
+/* - - - - - - - - - - -*/
+
+/* usage: proj2-check [-s] [-j THREADS] [-b] [FILE], FILE is proj2.out by default, "-" reads standard input,
+   -s checks order of lines, -j sets number of threads, -b measures speed of the check with more and more threads */
+int main(int argc, char *argv[])
+{
+    // [0] - parse arguments and map the log
+    bool semantic = false, bench = false;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    char *endptr;
+    while ((opt = getopt(argc, argv, "sj:b")) != -1) {
+        if (opt == 's') {
+            semantic = true;
+        } else if (opt == 'b') {
+            bench = true;
+        } else if (opt == 'j' && (threads = strtol(optarg, &endptr, 10)) > 0 && *endptr == '\0' && threads <= CK_THREADS_MAX) {
+            continue;
+        } else {
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind + 1 < argc || optind > argc) {
+        fprintf(stderr, "[%s] - Wrong arguments, usage: %s [-s] [-j THREADS] [-b] [FILE]\n", PROGRAM_NAME, argv[0]);
+        return 1;
+    }
+    const char *path = (optind < argc) ? argv[optind] : "proj2.out";
+    size_t size;
+    bool mapped;
+    const char *log = CK_Map(path, &size, &mapped);
+    if (log == NULL) {
+        fprintf(stderr, "[%s] - Log %s can't be read\n", PROGRAM_NAME, path);
+        return 1;
+    }
+
+    // [1] - check the log, parallel check only tells if the log is correct, so an incorrect log is checked once more
+    //       sequentially to report the errors in order
+    int errors;
+    unsigned long count[CK_FORM_NUM];
+    if (bench) {
+        errors = CK_Bench(log, size, semantic, threads);
+    } else if (threads > 1 && CK_CheckParallel(log, size, semantic, threads, count) == 0) {
+        errors = CK_Report(count);
+    } else {
+        errors = CK_CheckSequential(log, size, semantic);
+    }
+
+    // [2] - release the log
+    if (mapped) {
+        if (size > 0) {
+            munmap((void *)log, size);
+        }
+    } else {
+        free((void *)log);
+    }
+    return (errors == 0) ? 0 : (errors < 0) ? 1 : 2;
+}
+
+
+
+/* - - - - - - - - - - -*/
+/*      FUNCTIONS       */
+/* - - - - - - - - - - -*/
+
+/**
+ * Finds the next newline, 16 bytes are compared at once when SSE2 is available.
+ *
+ * @param ptr Start of the search.
+ * @param end End of the log.
+ * @return const char* Pointer to the newline, end if there is none.
+ */
+const char *CK_FindNewline(const char *ptr, const char *end)
+{
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - ptr >= 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)ptr), newline));
+        if (mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+        ptr += 16;
+    }
+#endif
+    const char *newline_ptr = memchr(ptr, '\n', end - ptr);
+    return (newline_ptr != NULL) ? newline_ptr : end;
+}
+
+/**
+ * Parses a decimal number with at least one digit.
+ *
+ * @param ptr (in/out) Position in the line, moved after the number.
+ * @param end End of the line.
+ * @param value (out) Parsed number.
+ * @return bool true if there was a number.
+ */
+static inline bool CK_ParseNumber(const char **ptr, const char *end, unsigned long *value)
+{
+    const char *p = *ptr;
+    unsigned long v = 0;
+    while (p < end && (unsigned char)(*p - '0') <= 9) {
+        v = v * 10 + (unsigned long)(*p - '0');
+        p++;
+    }
+    if (p == *ptr) {
+        return false;
+    }
+    *value = v;
+    *ptr = p;
+    return true;
+}
+
+/**
+ * Parses one line of the log ("N: closing" or "N: R n: text"), same forms as kontrola-vystupu.py accepts.
+ *
+ * @param ptr Start of the line.
+ * @param end End of the line (without the newline).
+ * @param line (out) Parsed line.
+ * @return int return(0) if the line has a known form, return(-1) if not.
+ */
+int CK_ParseLine(const char *ptr, const char *end, CKLine *line)
+{
+    line->form = CK_ERROR;
+    line->id = (unsigned long)-1;
+    line->service = 0;
+
+    // [0] - number of the line
+    if (!CK_ParseNumber(&ptr, end, &(line->counter)) || end - ptr < 2 || ptr[0] != ':' || ptr[1] != ' ') {
+        return -1;
+    }
+    ptr += 2;
+    if (end - ptr == 7 && memcmp(ptr, "closing", 7) == 0) {
+        line->form = CK_CLOSING;
+        return 0;
+    }
+
+    // [1] - role and number of the process
+    if (end - ptr < 2 || (ptr[0] != 'Z' && ptr[0] != 'U') || ptr[1] != ' ') {
+        return -1;
+    }
+    char role = ptr[0];
+    ptr += 2;
+    if (!CK_ParseNumber(&ptr, end, &(line->id)) || end - ptr < 2 || ptr[0] != ':' || ptr[1] != ' ') {
+        return -1;
+    }
+    ptr += 2;
+
+    // [2] - text of the line, lengths differ so mostly one memcmp is done
+    size_t len = end - ptr;
+    for (int i = 0; i < CK_FORM_NUM - 1; i++) {
+        if (CK_Forms[i].role != role || len != CK_Forms[i].len + CK_Forms[i].service ||
+            memcmp(ptr, CK_Forms[i].text, CK_Forms[i].len) != 0) {
+            continue;
+        }
+        if (CK_Forms[i].service) {
+            char type = ptr[CK_Forms[i].len];
+            if (type < '1' || type > '3') {
+                return -1;
+            }
+            line->service = type - '0';
+        }
+        line->form = (CKForm)i;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Maps the log into memory, logs which can't be mapped (pipes) are read into a buffer.
+ *
+ * @param path Path to the log, "-" is standard input.
+ * @param size (out) Size of the log.
+ * @param mapped (out) true if the log is mapped, false if it's in an allocated buffer.
+ * @return const char* Content of the log, NULL on error.
+ */
+const char *CK_Map(const char *path, size_t *size, bool *mapped)
+{
+    int fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    // regular file is mapped
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        *size = st.st_size;
+        *mapped = true;
+        if (*size == 0) {
+            close(fd);
+            return "";
+        }
+        void *log = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (log == MAP_FAILED) {
+            return NULL;
+        }
+        madvise(log, *size, MADV_SEQUENTIAL);
+        return log;
+    }
+
+    // pipe is read chunk by chunk
+    *mapped = false;
+    size_t cap = CK_READ_CHUNK;
+    char *log = malloc(cap);
+    *size = 0;
+    ssize_t got;
+    while (log != NULL && (got = read(fd, log + *size, cap - *size)) > 0) {
+        *size += got;
+        if (*size == cap) {
+            char *bigger = realloc(log, cap *= 2);
+            if (bigger == NULL) {
+                free(log);
+            }
+            log = bigger;
+        }
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return log;
+}
+
+
+
+/* - - - - - - - - - - - - -*/
+/*    SEMANTIC FUNCTIONS    */
+/* - - - - - - - - - - - - -*/
+// Functions which check the order of lines, one pass and O(1) work per line
+
+/**
+ * Creates empty state of the semantic check.
+ *
+ * @param sem Pointer to the state.
+ * @return int returns(0) if the state was created, returns(-1) if not.
+ */
+int CK_SemanticInit(CKSemantic *sem)
+{
+    memset(sem, 0, sizeof(CKSemantic));
+    sem->cap = CK_ACTORS_INIT;
+    sem->actor = calloc(sem->cap, sizeof(CKActor));
+    return (sem->actor != NULL) ? 0 : -1;
+}
+
+/**
+ * Reports a semantic error, only the first CK_REPORT_MAX errors are printed.
+ *
+ * @param sem Pointer to the state.
+ * @param line Parsed line.
+ * @param ptr Start of the line.
+ * @param end End of the line.
+ * @param message Description of the error.
+ */
+static void CK_SemanticError(CKSemantic *sem, const CKLine *line, const char *ptr, const char *end, const char *message)
+{
+    if (++(sem->errors) <= CK_REPORT_MAX) {
+        printf("ERROR: line %lu: %s: %.*s\n", line->counter, message, (int)(end - ptr), ptr);
+    }
+}
+
+/**
+ * Finds the actor in the hash table, new actors are added in state CK_S_NEW.
+ *
+ * @param sem Pointer to the state.
+ * @param key Key of the actor (2 * id, + 1 for officers).
+ * @return CKActor* Pointer to the actor, NULL if the table can't grow.
+ */
+static CKActor *CK_SemanticActor(CKSemantic *sem, unsigned long key)
+{
+    // table is kept at most half full
+    if (2 * (sem->num + 1) > sem->cap) {
+        CKActor *old = sem->actor;
+        size_t old_cap = sem->cap;
+        sem->actor = calloc(2 * old_cap, sizeof(CKActor));
+        if (sem->actor == NULL) {
+            sem->actor = old;
+            return NULL;
+        }
+        sem->cap = 2 * old_cap;
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old[i].state != CK_S_NEW) {
+                size_t j = (old[i].key * 0x9E3779B97F4A7C15ULL) & (sem->cap - 1);
+                while (sem->actor[j].state != CK_S_NEW) {
+                    j = (j + 1) & (sem->cap - 1);
+                }
+                sem->actor[j] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    size_t i = (key * 0x9E3779B97F4A7C15ULL) & (sem->cap - 1);
+    while (sem->actor[i].state != CK_S_NEW && sem->actor[i].key != key) {
+        i = (i + 1) & (sem->cap - 1);
+    }
+    if (sem->actor[i].state == CK_S_NEW) {
+        sem->actor[i].key = key;
+        sem->num++;
+    }
+    return &(sem->actor[i]);
+}
+
+/**
+ * Checks one line - numbers of lines go one after another, the actor of the line is in a state where the line
+ * can follow, nobody enters after closing and every called customer matches an officer serving his service.
+ *
+ * @param sem Pointer to the state.
+ * @param line Parsed line.
+ * @param ptr Start of the line.
+ * @param end End of the line.
+ */
+void CK_SemanticLine(CKSemantic *sem, const CKLine *line, const char *ptr, const char *end)
+{
+    // [0] - lines are numbered 1, 2, 3, ...
+    if (line->counter != sem->counter + 1) {
+        CK_SemanticError(sem, line, ptr, end, "line number doesn't follow the previous one");
+    }
+    sem->counter = line->counter;
+
+    // [1] - closing happens once and nobody enters the office after it
+    if (line->form == CK_CLOSING) {
+        if (sem->closed) {
+            CK_SemanticError(sem, line, ptr, end, "office closed twice");
+        }
+        sem->closed = true;
+        return;
+    }
+    if (sem->closed && (line->form == CK_Z_ENTER || line->form == CK_Z_REJECTED)) {
+        CK_SemanticError(sem, line, ptr, end, "customer came to the office after closing");
+    }
+
+    // [2] - state machine of the actor
+    CKActor *actor = CK_SemanticActor(sem, 2 * line->id + (line->form >= CK_U_START));
+    if (actor == NULL) {
+        CK_SemanticError(sem, line, ptr, end, "out of memory");
+        return;
+    }
+    uint8_t next = CK_Next[actor->state][line->form];
+    if (next == CK_S_NEW) {
+        char message[64];
+        snprintf(message, sizeof(message), "not allowed when %s", CK_StateNames[actor->state]);
+        CK_SemanticError(sem, line, ptr, end, message);
+        return;
+    }
+    actor->state = next;
+
+    // [3] - officer prints serving before he wakes the customer up, so every called customer takes one serving officer
+    if (line->form == CK_Z_ENTER || line->form == CK_U_SERVING) {
+        actor->service = line->service;
+    }
+    if (line->form == CK_U_SERVING) {
+        sem->serving[line->service]++;
+    } else if (line->form == CK_Z_CALLED) {
+        if (sem->serving[actor->service] == 0) {
+            CK_SemanticError(sem, line, ptr, end, "no officer serves the service of the customer");
+        } else {
+            sem->serving[actor->service]--;
+        }
+    }
+}
+
+/**
+ * Checks that every actor went home and every serving officer called his customer.
+ *
+ * @param sem Pointer to the state.
+ */
+void CK_SemanticEnd(CKSemantic *sem)
+{
+    for (size_t i = 0; i < sem->cap; i++) {
+        CKActor *actor = &(sem->actor[i]);
+        if (actor->state != CK_S_NEW && actor->state != CK_S_HOME && ++(sem->errors) <= CK_REPORT_MAX) {
+            printf("ERROR: %c %lu: %s at the end of the log\n", (actor->key & 1) ? 'U' : 'Z', actor->key / 2,
+                   CK_StateNames[actor->state]);
+        }
+    }
+    for (int k = 1; k <= CK_SERVICE_NUM; k++) {
+        if (sem->serving[k] != 0 && ++(sem->errors) <= CK_REPORT_MAX) {
+            printf("ERROR: %lu officers served a service %d without a called customer\n", sem->serving[k], k);
+        }
+    }
+    if (sem->errors > CK_REPORT_MAX) {
+        printf("ERROR: %lu more semantic errors\n", sem->errors - CK_REPORT_MAX);
+    }
+}
+
+/**
+ * Releases the state of the semantic check.
+ *
+ * @param sem Pointer to the state.
+ */
+void CK_SemanticDestroy(CKSemantic *sem)
+{
+    free(sem->actor);
+    sem->actor = NULL;
+}
+
+
+
+/* - - - - - - - - - - - - -*/
+/*     CHECK FUNCTIONS      */
+/* - - - - - - - - - - - - -*/
+// Functions which check the whole log, sequentially or in parallel chunks
+
+/**
+ * Prints the same warnings and errors as kontrola-vystupu.py.
+ *
+ * @param count Number of lines of every form.
+ * @return int Number of errors.
+ */
+int CK_Report(const unsigned long count[])
+{
+    static const struct {
+        CKForm form;
+        const char *message;
+    } warnings[] = {
+        {CK_Z_START, "no Z started"}, {CK_Z_ENTER, "no Z entering office"},
+        {CK_Z_CALLED, "no Z called by office worker"}, {CK_Z_HOME, "no Z going home"},
+        {CK_U_START, "no U started"}, {CK_U_BREAK, "no U taking break"}, {CK_U_BREAK_END, "no U finishing break"},
+        {CK_U_SERVING, "no U serving a service"}, {CK_U_SERVED, "no U finished a service"}, {CK_CLOSING, "no closing"},
+    };
+    for (size_t i = 0; i < sizeof(warnings) / sizeof(warnings[0]); i++) {
+        if (count[warnings[i].form] == 0) {
+            printf("WARNING: %s\n", warnings[i].message);
+        }
+    }
+
+    int errors = 0;
+    if (count[CK_Z_HOME] != count[CK_Z_START]) {
+        printf("ERROR: Z started more than gone home\nZ started:%lu\nZ gone home:%lu\n",
+               count[CK_Z_START], count[CK_Z_HOME]);
+        errors++;
+    }
+    if (count[CK_U_HOME] != count[CK_U_START]) {
+        printf("ERROR: U started more than gone home\nU started:%lu\nU gone home:%lu\n",
+               count[CK_U_START], count[CK_U_HOME]);
+        errors++;
+    }
+    if (count[CK_U_SERVING] != count[CK_U_SERVED]) {
+        printf("ERROR: U started serving more than finished\nU started serving:%lu\nU finished serving:%lu\n",
+               count[CK_U_SERVING], count[CK_U_SERVED]);
+        errors++;
+    }
+    if (count[CK_U_BREAK] != count[CK_U_BREAK_END]) {
+        printf("ERROR: U started more breaks than finished\nU started %lu breaks\nU finished %lu breaks\n",
+               count[CK_U_BREAK], count[CK_U_BREAK_END]);
+        errors++;
+    }
+    if (count[CK_Z_ENTER] != count[CK_Z_CALLED] + count[CK_Z_RENEGED]) {
+        printf("ERROR: Called less Z than entered service queues\nZ entered: %lu\nZ called: %lu\nZ left the queue: %lu\n",
+               count[CK_Z_ENTER], count[CK_Z_CALLED], count[CK_Z_RENEGED]);
+        errors++;
+    }
+    return errors;
+}
+
+/**
+ * Checks the log line by line and reports every error in order.
+ *
+ * @param log Content of the log.
+ * @param size Size of the log.
+ * @param semantic Check order of lines too.
+ * @return int Number of errors, (-1) if memory ran out.
+ */
+int CK_CheckSequential(const char *log, size_t size, bool semantic)
+{
+    CKSemantic sem;
+    if (semantic && CK_SemanticInit(&sem) != 0) {
+        return -1;
+    }
+
+    // [0] - count lines of every form
+    unsigned long count[CK_FORM_NUM] = {0};
+    const char *end = log + size;
+    for (const char *ptr = log; ptr < end; ) {
+        const char *nl = CK_FindNewline(ptr, end);
+        CKLine line;
+        if (CK_ParseLine(ptr, nl, &line) == 0) {
+            count[line.form]++;
+            if (semantic) {
+                CK_SemanticLine(&sem, &line, ptr, nl);
+            }
+        } else {
+            // the line is printed with it's newline, like python does
+            printf("Line format error: %.*s\n", (int)(nl - ptr) + (nl < end), ptr);
+        }
+        ptr = nl + 1;
+    }
+
+    // [1] - same checks as kontrola-vystupu.py
+    int errors = CK_Report(count);
+
+    // [2] - actors which didn't finish
+    if (semantic) {
+        CK_SemanticEnd(&sem);
+        errors += (sem.errors > 0);
+        CK_SemanticDestroy(&sem);
+    }
+    return errors;
+}
+
+/**
+ * Finds the actor in the hash table of the chunk, new actors get identity mapping of states.
+ *
+ * @param chunk Pointer to the chunk.
+ * @param key Key of the actor (2 * id, + 1 for officers).
+ * @return CKSummary* Pointer to the actor, NULL if the table can't grow.
+ */
+static CKSummary *CK_ChunkActor(CKChunk *chunk, unsigned long key)
+{
+    // table is kept at most half full
+    if (2 * (chunk->num + 1) > chunk->cap) {
+        CKSummary *old = chunk->actor;
+        size_t old_cap = chunk->cap;
+        chunk->actor = calloc(2 * old_cap, sizeof(CKSummary));
+        if (chunk->actor == NULL) {
+            chunk->actor = old;
+            return NULL;
+        }
+        chunk->cap = 2 * old_cap;
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old[i].used) {
+                size_t j = (old[i].key * 0x9E3779B97F4A7C15ULL) & (chunk->cap - 1);
+                while (chunk->actor[j].used) {
+                    j = (j + 1) & (chunk->cap - 1);
+                }
+                chunk->actor[j] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    size_t i = (key * 0x9E3779B97F4A7C15ULL) & (chunk->cap - 1);
+    while (chunk->actor[i].used && chunk->actor[i].key != key) {
+        i = (i + 1) & (chunk->cap - 1);
+    }
+    CKSummary *actor = &(chunk->actor[i]);
+    if (!actor->used) {
+        actor->used = true;
+        actor->key = key;
+        for (int s = 0; s < CK_STATE_NUM; s++) {
+            actor->next[s] = s;
+        }
+        chunk->num++;
+    }
+    return actor;
+}
+
+/**
+ * Thread which checks one chunk. States of actors at the start of the chunk aren't known yet, so every actor gets
+ * the mapping of all his possible states, composed line by line from CK_Next. Calls of customers who entered in an
+ * earlier chunk are remembered with balances of services, so they can be matched with serving officers in the merge.
+ *
+ * @param arg Pointer to the chunk.
+ * @return void* NULL.
+ */
+static void *CK_ChunkCheck(void *arg)
+{
+    CKChunk *chunk = arg;
+    chunk->sequence = true;
+    if (chunk->semantic && (chunk->actor = calloc(chunk->cap = CK_ACTORS_INIT, sizeof(CKSummary))) == NULL) {
+        chunk->failed = true;
+        return NULL;
+    }
+
+    for (const char *ptr = chunk->begin; ptr < chunk->end; ) {
+        const char *nl = CK_FindNewline(ptr, chunk->end);
+        CKLine line;
+        int ret = CK_ParseLine(ptr, nl, &line);
+        ptr = nl + 1;
+        if (ret != 0) {
+            chunk->format_errors++;
+            continue;
+        }
+        chunk->count[line.form]++;
+        if (!chunk->semantic) {
+            continue;
+        }
+
+        // [0] - line numbers inside the chunk, closing and customers who came to the office
+        if (chunk->first == 0) {
+            chunk->first = line.counter;
+        } else if (line.counter != chunk->last + 1) {
+            chunk->sequence = false;
+        }
+        chunk->last = line.counter;
+        if (line.form == CK_CLOSING) {
+            chunk->closing = (chunk->closings++ == 0) ? line.counter : chunk->closing;
+            continue;
+        }
+        if (line.form == CK_Z_ENTER || line.form == CK_Z_REJECTED) {
+            chunk->came = line.counter;
+        }
+
+        // [1] - composition of the state machine of the actor
+        CKSummary *actor = CK_ChunkActor(chunk, 2 * line.id + (line.form >= CK_U_START));
+        if (actor == NULL) {
+            chunk->failed = true;
+            return NULL;
+        }
+        for (int s = 0; s < CK_STATE_NUM; s++) {
+            if (actor->next[s] != CK_S_BAD) {
+                uint8_t next = CK_Next[actor->next[s]][line.form];
+                actor->next[s] = (next == CK_S_NEW) ? CK_S_BAD : next;
+            }
+        }
+
+        // [2] - balances of services, called customer takes a serving officer
+        if (line.form == CK_Z_ENTER) {
+            actor->service = line.service;
+        } else if (line.form == CK_U_SERVING) {
+            chunk->balance[line.service]++;
+        } else if (line.form == CK_Z_CALLED && actor->service != 0) {
+            int k = actor->service;
+            chunk->balance[k]--;
+            chunk->low[k] = (chunk->balance[k] < chunk->low[k]) ? chunk->balance[k] : chunk->low[k];
+        } else if (line.form == CK_Z_CALLED) {
+            if (chunk->call_num == chunk->call_cap) {
+                CKCall *bigger = realloc(chunk->call, (chunk->call_cap = 2 * chunk->call_cap + 16) * sizeof(CKCall));
+                if (bigger == NULL) {
+                    chunk->failed = true;
+                    return NULL;
+                }
+                chunk->call = bigger;
+            }
+            CKCall *call = &(chunk->call[chunk->call_num++]);
+            call->key = actor->key;
+            memcpy(call->balance, chunk->balance, sizeof(call->balance));
+            memcpy(call->low, chunk->low, sizeof(call->low));
+            memcpy(chunk->low, chunk->balance, sizeof(chunk->low));
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Merges summary of a chunk into the state of the whole log.
+ *
+ * @param sem State of actors before the chunk, changed to the state after it.
+ * @param chunk Pointer to the chunk.
+ * @param carry Balances of services before the chunk, changed to the balances after it.
+ * @return bool true if the chunk can follow the previous ones.
+ */
+static bool CK_ChunkMerge(CKSemantic *sem, const CKChunk *chunk, long carry[])
+{
+    // [0] - unknown calls get services of customers from the earlier chunks
+    long taken[CK_SERVICE_NUM + 1] = {0};
+    for (size_t i = 0; i < chunk->call_num; i++) {
+        const CKCall *call = &(chunk->call[i]);
+        for (int k = 1; k <= CK_SERVICE_NUM; k++) {
+            if (carry[k] + call->low[k] - taken[k] < 0) {
+                return false;
+            }
+        }
+        CKActor *actor = CK_SemanticActor(sem, call->key);
+        if (actor == NULL || actor->service == 0) {
+            return false;
+        }
+        int k = actor->service;
+        taken[k]++;
+        if (carry[k] + call->balance[k] - taken[k] < 0) {
+            return false;
+        }
+    }
+    for (int k = 1; k <= CK_SERVICE_NUM; k++) {
+        if (carry[k] + chunk->low[k] - taken[k] < 0) {
+            return false;
+        }
+        carry[k] += chunk->balance[k] - taken[k];
+    }
+
+    // [1] - states of actors after the chunk
+    for (size_t i = 0; i < chunk->cap; i++) {
+        const CKSummary *summary = &(chunk->actor[i]);
+        if (!summary->used) {
+            continue;
+        }
+        CKActor *actor = CK_SemanticActor(sem, summary->key);
+        if (actor == NULL || summary->next[actor->state] == CK_S_BAD) {
+            return false;
+        }
+        actor->state = summary->next[actor->state];
+        actor->service = (summary->service != 0) ? summary->service : actor->service;
+    }
+    return true;
+}
+
+/**
+ * Checks the log in line aligned chunks, one thread per chunk. Verdict is the same as the verdict of
+ * CK_CheckSequential(), but errors aren't reported.
+ *
+ * @param log Content of the log.
+ * @param size Size of the log.
+ * @param semantic Check order of lines too.
+ * @param threads Number of threads.
+ * @param count (out) Number of lines of every form.
+ * @return int return(0) if the log has no wrong line and passes the semantic check, return(1) if it doesn't,
+ *             return(-1) if the threads failed.
+ */
+int CK_CheckParallel(const char *log, size_t size, bool semantic, int threads, unsigned long count[])
+{
+    CKChunk *chunk = calloc(threads, sizeof(CKChunk));
+    pthread_t *thread = malloc(threads * sizeof(pthread_t));
+    if (chunk == NULL || thread == NULL) {
+        free(chunk);
+        free(thread);
+        return -1;
+    }
+
+    // [0] - split the log into line aligned chunks and check them
+    const char *end = log + size;
+    int started = 0, ret = 0;
+    for (int t = 0; t < threads; t++) {
+        chunk[t].begin = (t == 0) ? log : chunk[t - 1].end;
+        chunk[t].end = (t == threads - 1) ? end : chunk[t].begin + size / threads;
+        if (chunk[t].end > end) {
+            chunk[t].end = end;
+        } else if (chunk[t].end < end && chunk[t].end > chunk[t].begin) {
+            chunk[t].end = CK_FindNewline(chunk[t].end - 1, end) + 1;
+            chunk[t].end = (chunk[t].end > end) ? end : chunk[t].end;
+        }
+        chunk[t].semantic = semantic;
+        if (pthread_create(&(thread[t]), NULL, CK_ChunkCheck, &(chunk[t])) != 0) {
+            ret = -1;
+            break;
+        }
+        started++;
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(thread[t], NULL);
+    }
+
+    // [1] - merge the chunks in order
+    memset(count, 0, CK_FORM_NUM * sizeof(unsigned long));
+    CKSemantic sem = {0};
+    long carry[CK_SERVICE_NUM + 1] = {0};
+    unsigned long next_line = 1, closings = 0, closing = 0, came = 0;
+    if (ret == 0 && semantic && CK_SemanticInit(&sem) != 0) {
+        ret = -1;
+    }
+    for (int t = 0; t < started && ret == 0; t++) {
+        for (int f = 0; f < CK_FORM_NUM; f++) {
+            count[f] += chunk[t].count[f];
+        }
+        if (chunk[t].failed) {
+            ret = -1;
+        } else if (chunk[t].format_errors > 0) {
+            ret = 1;
+        } else if (semantic && chunk[t].first != 0) {
+            if (!chunk[t].sequence || chunk[t].first != next_line || !CK_ChunkMerge(&sem, &(chunk[t]), carry)) {
+                ret = 1;
+            }
+            next_line = chunk[t].last + 1;
+            closing = (closings == 0) ? chunk[t].closing : closing;
+            closings += chunk[t].closings;
+            came = (chunk[t].came > 0) ? chunk[t].came : came;
+        }
+    }
+
+    // [2] - the office closed once and nobody came after it, every actor went home and every serving was matched
+    if (ret == 0 && semantic) {
+        ret = (closings > 1 || (closings == 1 && came > closing));
+        for (int k = 1; k <= CK_SERVICE_NUM; k++) {
+            ret |= (carry[k] != 0);
+        }
+        for (size_t i = 0; i < sem.cap && ret == 0; i++) {
+            ret = (sem.actor[i].state != CK_S_NEW && sem.actor[i].state != CK_S_HOME);
+        }
+    }
+    if (semantic && sem.actor != NULL) {
+        CK_SemanticDestroy(&sem);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        free(chunk[t].actor);
+        free(chunk[t].call);
+    }
+    free(chunk);
+    free(thread);
+    return ret;
+}
+
+/**
+ * Measures speed of the parallel check with 1, 2, 4, ... threads, the best of CK_BENCH_RUNS runs is printed.
+ *
+ * @param log Content of the log.
+ * @param size Size of the log.
+ * @param semantic Check order of lines too.
+ * @param threads Max number of threads.
+ * @return int return(0), return(-1) if the check failed.
+ */
+int CK_Bench(const char *log, size_t size, bool semantic, int threads)
+{
+    printf("log: %.3f GB, %s check\n", size / 1e9, semantic ? "semantic" : "format");
+    for (int t = 1; t <= threads; t = (2 * t > threads && t < threads) ? threads : 2 * t) {
+        double best = 0.0;
+        int ret = 0;
+        for (int run = 0; run < CK_BENCH_RUNS; run++) {
+            struct timespec start, stop;
+            unsigned long count[CK_FORM_NUM];
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            ret = CK_CheckParallel(log, size, semantic, t, count);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            double sec = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+            best = (run == 0 || sec < best) ? sec : best;
+        }
+        if (ret < 0) {
+            return -1;
+        }
+        printf("threads %3d: %8.3f s, %6.2f GB/s%s\n", t, best, (best > 0) ? size / 1e9 / best : 0.0,
+               (ret == 0) ? "" : " (log isn't correct)");
+    }
+    return 0;
+}
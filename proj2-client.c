@@ -0,0 +1,65 @@
+/**
+ * @file proj2-client.c
+ * @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ * @brief External client of a named office (proj2 --office=NAME), sends customers to the office one after another.
+ * @date 2023-04-24
+ */
+
+/* - - - - - - - - - - -*/
+/*      DEFINITIONS     */
+/* - - - - - - - - - - -*/
+
+/* libraries */
+#include "office_client.h"
+
+/* constants */
+#define PROGRAM_NAME "proj2-client.c"
+
+
+
+/* - - - - - - - - - - -*/
+/*         MAIN         */
+/* - - - - - - - - - - -*/
+
+/* usage: proj2-client NAME COUNT [SEED] */
+int main(int argc, char *argv[]) 
+{
+    // [0] - parse arguments
+    char *endptr;
+    long count = (argc >= 3) ? strtol(argv[2], &endptr, 10) : -1;
+    if (argc < 3 || argc > 4 || *endptr != '\0' || count < 0) {
+        fprintf(stderr, "[%s] - Wrong arguments, usage: %s NAME COUNT [SEED]\n", PROGRAM_NAME, argv[0]);
+        return 1;
+    }
+    DSRandom rng;
+    DS_RandomSeed(&rng, (argc == 4) ? strtoul(argv[3], NULL, 10) : (unsigned long)getpid());
+
+    // [1] - attach the office
+    OCClient client;
+    if (OC_Attach(&client, argv[1]) != 0) {
+        fprintf(stderr, "[%s] - Office %s can't be attached\n", PROGRAM_NAME, argv[1]);
+        return 1;
+    }
+
+    // [2] - customers go to the office one after another, until the office closes
+    long served = 0, full = 0, rejected = 0, reneged = 0;
+    for (long i = 0; i < count; i++) {
+        int ret = OC_Service(&client, 1 + (int)(DS_RandomUniform(&rng) * SERVICE_NUM));
+        if (ret == 0) {
+            served++;
+        } else if (ret == 2) {
+            full++;
+        } else if (ret == PT_REJECTED) {
+            rejected++;
+        } else if (ret == PT_RENEGED) {
+            reneged++;
+        } else {
+            break;
+        }
+    }
+    printf("served %ld, office full %ld, rejected %ld, reneged %ld\n", served, full, rejected, reneged);
+
+    // [3] - detach the office
+    OC_Detach(&client);
+    return 0;
+}
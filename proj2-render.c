@@ -0,0 +1,77 @@
+/**
+ * @file proj2-render.c
+ * @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ * @brief Expands binary log of proj2 (--log-format=binary) into the text format of the assignment, so it can be
+ *        checked by kontrola-vystupu.py or proj2-check.
+ * @date 2023-04-24
+ */
+
+/* - - - - - - - - - - -*/
+/*      DEFINITIONS     */
+/* - - - - - - - - - - -*/
+
+/* libraries */
+#include <stdlib.h>
+#include "event_log.h"
+
+/* constants */
+#define PROGRAM_NAME "proj2-render.c"
+#define RD_RECORDS 4096         // number of records read at once
+#define RD_OUT_BUFFER 1048576   // size of the buffer of the standard output
+
+
+
+/* - - - - - - - - - - -*/
+/*         MAIN         */
+/* - - - - - - - - - - -*/
+
+/* usage: proj2-render [FILE], FILE is proj2.out by default, "-" reads standard input, text is printed to stdout */
+int main(int argc, char *argv[])
+{
+    // [0] - parse arguments and open the log
+    if (argc > 2) {
+        fprintf(stderr, "[%s] - Wrong arguments, usage: %s [FILE]\n", PROGRAM_NAME, argv[0]);
+        return 1;
+    }
+    const char *path = (argc == 2) ? argv[1] : "proj2.out";
+    FILE *file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "[%s] - Log %s can't be opened\n", PROGRAM_NAME, path);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOFBF, RD_OUT_BUFFER);
+
+    // [1] - every record is one line, fread() fills the whole buffer unless the log ends
+    static EVRecord records[RD_RECORDS];
+    unsigned long total = 0;
+    size_t bytes;
+    int ret = 0;
+    while (ret == 0 && (bytes = fread(records, 1, sizeof(records), file)) > 0) {
+        for (size_t i = 0; i < bytes / sizeof(EVRecord); i++, total++) {
+            if (EV_Render(stdout, &(records[i])) != 0) {
+                fprintf(stderr, "[%s] - Record %lu is wrong (event %u, role %u)\n", PROGRAM_NAME, total,
+                        records[i].event, records[i].role);
+                ret = 1;
+                break;
+            }
+        }
+
+        // [2] - log has to end with a whole record
+        if (ret == 0 && bytes % sizeof(EVRecord) != 0) {
+            fprintf(stderr, "[%s] - Log %s ends with a partial record\n", PROGRAM_NAME, path);
+            ret = 1;
+        }
+    }
+    if (ret == 0 && ferror(file)) {
+        fprintf(stderr, "[%s] - Log %s can't be read\n", PROGRAM_NAME, path);
+        ret = 1;
+    }
+
+    if (file != stdin) {
+        fclose(file);
+    }
+    if (fflush(stdout) != 0) {
+        ret = 1;
+    }
+    return ret;
+}
@@ -11,15 +11,61 @@
 
 /* libraries */
 #include "process_table.h"
+#include "distribution.h"
+
+/* optional arguments, given in form --name=value before or after the positional arguments */
+typedef struct ProjOptions {
+    const char *arrival;        // arrival process of customers (see DS_ArrivalInit)
+    const char *service[SERVICE_NUM];   // service time distributions of services (see DS_ServiceInit)
+    const char *policy;         // dispatch policy of officers (see SM_OfficeSetPolicy)
+    const char *weights;        // weights of services for weighted fair queueing (see SM_OfficeSetWeights)
+    const char *topology;       // topology of the office (see SM_OfficeSetTopology)
+    int shards;                 // number of shards of the office, (0) means one shard per officer
+    bool metrics;               // print metrics of the office to stderr at the end (--metrics)
+    bool autoscale;             // officers are hired and retired by queue depth (--autoscale=MIN,MAX,DEPTH,COOLDOWN)
+    int as_min, as_max;         // minimum and maximum number of officers
+    int as_depth;               // officers are hired when more customers wait for AUTOSCALE_SUSTAIN ticks
+    int as_cooldown;            // officers idle for more miliseconds go home
+    bool daemon;                // office stays open until a signal or the duration ends (--daemon[=MS])
+    int duration;               // duration of the daemon in miliseconds, (0) means until a signal
+    int report_interval;        // period of windowed metrics reports in miliseconds, (0) means no reports
+    const char *office;         // name of the shared memory of the office, external clients attach to it (--office=/NAME)
+    int clients;                // number of external clients which can be in the office at the same time
+    const char *queue_cap;      // max lengths of queues of services (see SM_OfficeSetQueueCap)
+    int patience;               // customers leave the queue after so many miliseconds, (0) means never
+    const char *log_format;     // format of the log proj2.out (see SM_CounterSetFormat)
+    const char *export_path;    // timelines of customers and officers are exported into this file (see SM_TimelineExport)
+    const char *timestamps;     // times of lines of the log are written into this file (see SM_CounterSetTimestamps)
+    const char *log_writer;     // lines are written by a writer thread (see SM_CounterSetWriter)
+    bool log_map;               // lines are copied into the mapped log (see SM_CounterSetMap)
+    const char *report;         // format of the summary of the run printed at the end, NULL if it isn't printed
+    const char *report_file;    // summary is written into this file instead of stderr
+    long log_reserve;           // bytes reserved in the mapped log, (0) estimates them from the arguments
+    unsigned long seed;         // seed of the random number generators
+} ProjOptions;
 
 /* functions */
+int parse_options(int argc, char *argv[], ProjOptions *opts, char *pos_argv[]);
 int parse_arguments(int argc, char *argv[], int arg_array[], int arg_num);
-int ran_num(int min_num, int max_num);
+void stop_handler(int sig);
+
+/* set by SIGINT/SIGTERM, daemon closes the office */
+static volatile sig_atomic_t stop_signal = 0;
 
 /* constants */
 #define PROGRAM_NAME "proj2.c"
 #define ARG_NUM 5
 #define P_TYPE_NUM 2
+#define LOG_PATH "proj2.out"    // log of the run
+#define PT_INIT_SIZE 1024       // max initial number of processes in a tag of the process table
+#define DAEMON_TICK_MS 10       // period of checking the stop signal by the daemon
+#define OFFICE_CLIENTS 64       // default number of external clients in a named office
+#define AUTOSCALE_TICK_MS 1     // period of checking queues by autoscaling
+#define AUTOSCALE_SUSTAIN 3     // number of ticks queues have to stay long before a new officer is hired
+#define LOG_LINE_MAX 64         // reservation of the mapped log per line
+#define LOG_LINES_Z 6           // lines of a customer and of the officer who serves him
+#define LOG_LINES_U 256         // lines of an officer (start, breaks, going home), the log grows if it isn't enough
+#define LOG_MAP_MIN (1 << 20)   // min reservation of the mapped log
 
 
 
@@ -30,9 +76,14 @@ int ran_num(int min_num, int max_num);
 int main(int argc, char *argv[]) 
 {
     // [0] - program parses arguments and opens a log file
+    // separate optional arguments from the positional ones
+    ProjOptions opts;
+    char *pos_argv[argc + 1];
+    int pos_argc = parse_options(argc, argv, &opts, pos_argv);
+
     // parse arguments and them to array
     int arg_arr[ARG_NUM];
-    if (parse_arguments(argc, argv, arg_arr, ARG_NUM) != 0) {
+    if (pos_argc < 0 || parse_arguments(pos_argc, pos_argv, arg_arr, ARG_NUM) != 0) {
         fprintf(stderr, "[%s] - Wrong arguments\n", PROGRAM_NAME);
         return 1;
     }
@@ -44,20 +95,55 @@ int main(int argc, char *argv[])
     int arg_tu = arg_arr[3];    // max ammount of time officer can take a break in miliseconds
     int arg_f  = arg_arr[4];    // max amount of post office is going to be open in miliseconds
 
-    // open log file proj2.out
-    FILE *log_file = fopen("proj2.out", "w");
+    // initialize arrival process of customers
+    DSArrival arrival;
+    if (DS_ArrivalInit(&arrival, opts.arrival, opts.seed) != 0) {
+        fprintf(stderr, "[%s] - Wrong arrival process\n", PROGRAM_NAME);
+        return 1;
+    }
+    bool open_loop = (arrival.type != DS_ARRIVAL_UNIFORM);
+
+    // daemon needs a steady stream of customers, it's stopped by SIGINT/SIGTERM
+    if (opts.daemon && !open_loop) {
+        fprintf(stderr, "[%s] - Daemon needs an open-loop arrival process\n", PROGRAM_NAME);
+        return 1;
+    }
+    if (opts.daemon) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = stop_handler;
+        sigemptyset(&(sa.sa_mask));
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+
+    // mapped log is written at offsets, the writer thread can't write it too
+    if (opts.log_map && opts.log_writer != NULL) {
+        fprintf(stderr, "[%s] - Mapped log can't be written by the log writer\n", PROGRAM_NAME);
+        return 1;
+    }
 
-    // check if the log file was opened
-    if (log_file == NULL) {
+    // open log file proj2.out, mapped log is opened by the counter (see SM_CounterSetMap), so processes don't
+    // inherit a stream of it
+    FILE *log_file = NULL;
+    if (!opts.log_map && (log_file = fopen(LOG_PATH, "w")) == NULL) {
         fprintf(stderr, "[%s] - Error while opening log file\n", PROGRAM_NAME);
         return 1;
     }
 
+    // external clients append to the log, so the office has to append too, the log writer writes at offsets and
+    // clients send their lines through it's ring, so appends aren't used with it
+    if (opts.office != NULL && log_file != NULL && opts.log_writer == NULL) {
+        fcntl(fileno(log_file), F_SETFL, O_APPEND);
+    }
+
 
     // [1] - program creates shared memory for process table and initialize semaphores    
-    // get max number of processes and create process table with max number of processes
-    int max_p_num = (arg_nz > arg_nu) ? arg_nz : arg_nu;  
-    PTList *list = PT_Init(P_TYPE_NUM, max_p_num);             
+    // every tag is sized for it's own number of processes (at most the common case) and grows when it's full
+    int max_nu = (opts.autoscale && opts.as_max > arg_nu) ? opts.as_max : arg_nu;
+    char *p_keys[P_TYPE_NUM] = {"Z", "U"};
+    size_t p_sizes[P_TYPE_NUM] = {MAX(MIN(arg_nz, PT_INIT_SIZE), 1), MAX(MIN(max_nu, PT_INIT_SIZE), 1)};
+    PTList *list = PT_InitNamed(P_TYPE_NUM, p_keys, p_sizes, opts.office);             
     
     // check if the process table was created
     if (list == NULL) {
@@ -68,7 +154,66 @@ int main(int argc, char *argv[])
     // initialze shared memory data
     int err_ret;
     err_ret = SM_CounterInit(list->shared_data);
-    err_ret = SM_OfficeInit(list->shared_data);
+    err_ret += SM_OfficeInit(list->shared_data, arg_nz, opts.seed);
+
+    // binary log is expanded to text lines by proj2-render
+    if (opts.log_format != NULL) {
+        err_ret += SM_CounterSetFormat(list->shared_data, opts.log_format);
+    }
+
+    // log stays the same, times of it's lines go into a side file
+    if (opts.timestamps != NULL) {
+        err_ret += SM_CounterSetTimestamps(list->shared_data, opts.timestamps);
+    }
+
+    // storage latency isn't paid under the counter semaphore
+    if (opts.log_writer != NULL) {
+        err_ret += SM_CounterSetWriter(list->shared_data, log_file, opts.log_writer);
+    }
+
+    // lines are placed into the mapped log, customers print few lines, officers print one per break too
+    if (opts.log_map) {
+        size_t reserve = (opts.log_reserve > 0) ? (size_t)opts.log_reserve
+                       : MAX(LOG_MAP_MIN, LOG_LINE_MAX * (LOG_LINES_Z * (size_t)arg_nz + LOG_LINES_U * (size_t)max_nu));
+        err_ret += SM_CounterSetMap(list->shared_data, LOG_PATH, reserve);
+    }
+
+    // timelines of customers and officers for analysis tools
+    if (opts.export_path != NULL) {
+        err_ret += SM_TimelineInit(list->shared_data, SM_TL_ROWS);
+    }
+
+    // set dispatch policy of officers
+    if (opts.policy != NULL) {
+        err_ret += SM_OfficeSetPolicy(list->shared_data, opts.policy);
+    }
+    if (opts.weights != NULL) {
+        err_ret += SM_OfficeSetWeights(list->shared_data, opts.weights);
+    }
+
+    // set topology of the office
+    if (opts.topology != NULL) {
+        err_ret += SM_OfficeSetTopology(list->shared_data, opts.topology, (opts.shards > 0) ? opts.shards : arg_nu);
+    }
+
+    // named office can be attached by external clients
+    if (opts.office != NULL) {
+        err_ret += SM_OfficeSetClients(list->shared_data, opts.clients);
+        err_ret += SM_OfficeSetLog(list->shared_data, LOG_PATH);
+    }
+
+    // admission control - full queues reject customers, impatient customers leave the queue
+    if (opts.queue_cap != NULL) {
+        err_ret += SM_OfficeSetQueueCap(list->shared_data, opts.queue_cap);
+    }
+    err_ret += SM_OfficeSetPatience(list->shared_data, opts.patience);
+
+    // set service time distributions of services
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        if (opts.service[i] != NULL) {
+            err_ret += SM_OfficeSetService(list->shared_data, i + 1, opts.service[i]);
+        }
+    }
 
     // check if the shared memory data was initialized
     if (err_ret != 0) {
@@ -77,27 +222,38 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    // report memory footprint of the shared memory
+    if (opts.metrics) {
+        fprintf(stderr, "memory: process table %zu B (Z %zu slots, U %zu slots), office %zu B\n",
+                PT_Footprint(list), p_sizes[0], p_sizes[1], SM_OfficeFootprint(list->shared_data));
+    }
+
 
     // [2] - main process creates nz number of customer processes and nu number of officer processes
     // process data variable declarations
-    char buffer[BUFFER_SIZE] = {0};
     int tag_num = 0, pro_num = 0;
     
-    // create officer/uradnik processes  U
-    for (int i = 0; i < arg_nz; i++) {
+    // create customer/zakaznik processes Z, open-loop customers are created later by the arrival process
+    for (int i = 0; i < arg_nz && !open_loop; i++) {
         if (is_init_pid(list)) {
             tag_num = 0, pro_num = i;       // save the process number
-            PT_ProcessCreate(list, "Z");    // create the process
+            if (PT_ProcessCreate(list, "Z") < 0) {
+                fprintf(stderr, "[%s] - Error while creating customer %d\n", PROGRAM_NAME, i);
+            }
         } else {
             break;
         }
     }
 
-    // create customer/zakaznik processes Z 
+    // create officer/uradnik processes U
     for (int i = 0; i < arg_nu; i++) {
         if (is_init_pid(list)) {
             tag_num = 1, pro_num = i;       // save the process number
-            PT_ProcessCreate(list, "U");    // create the process
+            SM_OfficeHire(list->shared_data);
+            if (PT_ProcessCreate(list, "U") < 0) {
+                fprintf(stderr, "[%s] - Error while creating officer %d\n", PROGRAM_NAME, i);
+                SM_OfficeRetire(list->shared_data, 0);
+            }
         } else {
             break;
         }
@@ -105,7 +261,7 @@ int main(int argc, char *argv[])
 
 
     // [3] - then main process sleeps for random ammount of time between f/2 and f miliseconds
-    if (is_init_pid(list)) {
+    if (is_init_pid(list) && !open_loop && !opts.autoscale) {
         tag_num = 2, pro_num = 0;    // differentiate main process 
 
         // sleep for random ammount of time between f/2 and f miliseconds
@@ -116,7 +272,122 @@ int main(int argc, char *argv[])
 
         // the main process prints "A: closing\n"
         SM_OfficeClose(list->shared_data);
-        SM_CounterPrint(list->shared_data, log_file, "closing");
+        SM_CounterEvent(list->shared_data, log_file, EV_CLOSING, 0, 0);
+    }
+
+    // [3] - (open-loop, autoscaling, daemon) main process spawns customers at arrival times and officers when the queues
+    //       are too long, until it closes the office
+    if (is_init_pid(list) && (open_loop || opts.autoscale)) {
+        tag_num = 2, pro_num = 0;    // differentiate main process 
+
+        // arrival, closing and control times are absolute, so spawning doesn't slow them down
+        uint64_t t_start = nsec_now();
+        DSRandom rng;
+        DS_RandomSeed(&rng, opts.seed);
+        uint64_t t_close = t_start + (uint64_t)(arg_f/2 + (int)(DS_RandomUniform(&rng) * (arg_f - arg_f/2 + 1))) * DS_NSEC_PER_MSEC;
+        if (opts.daemon) {
+            t_close = (opts.duration > 0) ? t_start + (uint64_t)opts.duration * DS_NSEC_PER_MSEC : UINT64_MAX;
+        }
+        uint64_t t_next = open_loop ? t_start + DS_ArrivalNext(&arrival) : UINT64_MAX;
+        uint64_t t_tick = opts.autoscale ? t_start + AUTOSCALE_TICK_MS * DS_NSEC_PER_MSEC : UINT64_MAX;
+        uint64_t t_report = (opts.report_interval > 0) ? t_start + (uint64_t)opts.report_interval * DS_NSEC_PER_MSEC : UINT64_MAX;
+        uint64_t t_stop = opts.daemon ? t_start + DAEMON_TICK_MS * DS_NSEC_PER_MSEC : UINT64_MAX;
+        int customers = open_loop ? 0 : arg_nz;     // number of created customers
+        int dropped = 0;                            // number of customers who didn't fit into the office (daemon)
+        int officers = arg_nu;                      // number of the next officer
+        int above = 0;                              // number of consecutive ticks with queues above the threshold
+        bool closed = false;
+
+        // snapshot of metrics at the start of the report window
+        SM_Metrics window;
+        memset(&window, 0, sizeof(window));
+        window.t_start = t_start;
+
+        while (true) {
+            // daemon generates customers until the office closes, otherwise there are nz customers
+            bool arrivals = opts.daemon ? !closed : customers < arg_nz;
+            if (!arrivals && closed && !(opts.autoscale && SM_OfficeWaiting(list->shared_data) > 0)) {
+                break;
+            }
+
+            // customers arriving after closing would find the office closed, there is no need to wait for them
+            if (closed && arrivals) {
+                t_next = 0;
+            }
+
+            // waiting for the next event
+            uint64_t t_event = MIN(t_tick, MIN(t_report, t_stop));
+            if (arrivals && t_next < t_event) {
+                t_event = t_next;
+            }
+            if (!closed && t_close <= t_event) {
+                t_event = t_close;
+            }
+            nsec_sleep_until(t_event);
+
+            // the office closes at the deadline or when the daemon is stopped by a signal
+            if (!closed && (t_close == t_event || stop_signal)) {
+                SM_OfficeClose(list->shared_data);
+                SM_CounterEvent(list->shared_data, log_file, EV_CLOSING, 0, 0);
+                closed = true;
+                t_stop = UINT64_MAX;
+                continue;
+            }
+            if (t_stop == t_event) {
+                t_stop += DAEMON_TICK_MS * DS_NSEC_PER_MSEC;
+            }
+
+            // periodic report of the window
+            if (t_report == t_event) {
+                t_report += (uint64_t)opts.report_interval * DS_NSEC_PER_MSEC;
+                SM_MetricsWindow(list->shared_data, stderr, &window);
+            }
+
+            // next customer arrives, daemon customers who don't fit into the table of customer records are dropped
+            if (arrivals && t_next == t_event) {
+                if (!closed) {
+                    t_next += DS_ArrivalNext(&arrival);
+                }
+                if (opts.daemon && PT_ProcessCount(list, "Z") >= (unsigned int)arg_nz) {
+                    dropped++;
+                    continue;
+                }
+                tag_num = 0, pro_num = customers++;     // save the process number
+                pid_t pid = PT_ProcessCreate(list, "Z");
+                if (pid == 0) {
+                    break;
+                } else if (pid < 0) {
+                    fprintf(stderr, "[%s] - Error while creating customer %d\n", PROGRAM_NAME, pro_num);
+                }
+                tag_num = 2, pro_num = 0;
+                continue;
+            }
+
+            // autoscaling - hiring new officers when the queues stay long, officers which went home are reaped
+            // by the process table (SIGCHLD) and their slots are reused
+            if (t_tick == t_event) {
+                t_tick += AUTOSCALE_TICK_MS * DS_NSEC_PER_MSEC;
+                above = (SM_OfficeWaiting(list->shared_data) > opts.as_depth) ? above + 1 : 0;
+                if (above >= AUTOSCALE_SUSTAIN && SM_OfficeOfficers(list->shared_data) < opts.as_max) {
+                    above = 0;
+                    tag_num = 1, pro_num = officers++;      // save the process number
+                    SM_OfficeHire(list->shared_data);
+                    pid_t pid = PT_ProcessCreate(list, "U");
+                    if (pid == 0) {
+                        break;
+                    } else if (pid < 0) {
+                        fprintf(stderr, "[%s] - Error while creating officer %d\n", PROGRAM_NAME, pro_num);
+                        SM_OfficeRetire(list->shared_data, 0);
+                    }
+                    tag_num = 2, pro_num = 0;
+                }
+            }
+        }
+
+        if (is_init_pid(list) && opts.daemon && opts.metrics) {
+            fprintf(stderr, "daemon: %d customers, %d dropped (office full)\n", customers + dropped, dropped);
+        }
+        DS_ArrivalDestroy(&arrival);
     }
 
 
@@ -124,29 +395,26 @@ int main(int argc, char *argv[])
     if (tag_num == 0) {
 
         // print process started
-        sprintf(buffer, "Z %d: started", pro_num);
-        SM_CounterPrint(list->shared_data, log_file, buffer);
-        
-        // wait random ammount of time in interval <0, tz>
-        ran_msec_sleep(0, arg_tz);
-
-        // customer is going to the post office
-        if (list->shared_data->office.is_open == 1) {
+        SM_CounterEvent(list->shared_data, log_file, EV_Z_START, pro_num, 0);
         
-            // choosing service <1,3>
-            int service = ran_num(1,3);
+        // wait random ammount of time in interval <0, tz> (customer goes home right away when the office closes 
+        // meanwhile), open-loop customers are spawned at their arrival
+        if (!open_loop) {
+            SM_OfficeWaitClose(list->shared_data, ran_msec(0, arg_tz));
+        }
 
-            // print is chosing service n
-            sprintf(buffer, "Z %d: entering office for a service %d", pro_num, service);
-            SM_CounterPrint(list->shared_data, log_file, buffer);
+        // choosing service <1,3>, every customer has it's own generator, so runs with the same seed choose the same services
+        DSRandom rng;
+        DS_RandomSeedStream(&rng, opts.seed, DS_STREAM_CUSTOMER, (unsigned int)pro_num);
+        int service = 1 + (int)(DS_RandomUniform(&rng) * SERVICE_NUM);
 
-            // goes to front with service type <n>
-            SM_OfficeService(list->shared_data, log_file, pro_num, service);
-        } 
+        // customer is going to the post office, enters it and goes to front with service type <n> if it's open,
+        // daemon customers use records of their slots which are recycled
+        int record = opts.daemon ? PT_ProcessSlot() : pro_num;
+        SM_OfficeService(list->shared_data, log_file, pro_num, record, service);
 
         // customer is going home
-        sprintf(buffer, "Z %d: going home", pro_num);
-        SM_CounterPrint(list->shared_data, log_file, buffer);
+        SM_OfficeGoHome(list->shared_data, log_file, "Z", pro_num);
     }
 
 
@@ -154,32 +422,57 @@ int main(int argc, char *argv[])
     if (tag_num == 1) {
 
         // print process started
-        sprintf(buffer, "U %d: started", pro_num);
-        SM_CounterPrint(list->shared_data, log_file, buffer);
-
-        // cycle until the post office is closed
-        while (list->shared_data->office.is_open == 1 || list->shared_data->office.sem_1_count > 0 
-                || list->shared_data->office.sem_2_count > 0 || list->shared_data->office.sem_3_count > 0) {
-
-            // go to the random front and serve customers
-            SM_OfficeServe(list->shared_data, log_file, pro_num, arg_tu);
+        SM_CounterEvent(list->shared_data, log_file, EV_U_START, pro_num, 0);
+
+        // go to the front chosen by the dispatch policy and serve customers, until the post office is closed and empty
+        // or until the officer is idle for too long (autoscaling)
+        uint64_t t_busy = nsec_now();
+        int served;
+        while ((served = SM_OfficeServe(list->shared_data, log_file, pro_num, arg_tu)) != 1) {
+            if (served == 0) {
+                t_busy = nsec_now();
+            } else if (opts.autoscale && nsec_now() - t_busy > (uint64_t)opts.as_cooldown * DS_NSEC_PER_MSEC
+                       && SM_OfficeRetire(list->shared_data, opts.as_min)) {
+                break;
+            }
         }
 
         // officer is going home
-        sprintf(buffer, "U %d: going home", pro_num);
-        SM_CounterPrint(list->shared_data, log_file, buffer);
+        SM_OfficeGoHome(list->shared_data, log_file, "U", pro_num);
     }
 
 
     // [6] main process waits for all processes and destroys allocated data
     if (is_init_pid(list)) {
 
-        // wait for all processes to finish
-        for (int i = 0; i < (arg_nz + arg_nu); i++) {
-            wait(NULL);
+        // wait for all processes to finish and for the log to be written
+        PT_ProcessWaitAll(list);
+        SM_CounterWriterStop(list->shared_data, opts.metrics ? stderr : NULL);
+        SM_CounterMapStop(list->shared_data);
+
+        // print metrics of the office
+        if (opts.metrics) {
+            SM_MetricsPrint(list->shared_data, stderr);
+        }
+
+        // summary of the run, from counters of the shared data
+        if (opts.report != NULL) {
+            FILE *report_file = (opts.report_file != NULL) ? fopen(opts.report_file, "w") : stderr;
+            if (report_file == NULL || SM_MetricsReport(list->shared_data, report_file, opts.report) != 0) {
+                fprintf(stderr, "[%s] - Report can't be written\n", PROGRAM_NAME);
+            }
+            if (report_file != NULL && report_file != stderr) {
+                fclose(report_file);
+            }
+        }
+
+        // export timelines of customers and officers
+        if (opts.export_path != NULL && SM_TimelineExport(list->shared_data, opts.export_path) != 0) {
+            fprintf(stderr, "[%s] - Timelines can't be exported\n", PROGRAM_NAME);
         }
 
         // destroy existing data structures
+        SM_TimelineDestroy(list->shared_data);
         SM_CounterDestroy(list->shared_data);
         SM_OfficeDestroy(list->shared_data);
         PT_Destroy(&list);
@@ -193,6 +486,173 @@ int main(int argc, char *argv[])
 /*      FUNCTIONS       */
 /* - - - - - - - - - - -*/
 
+/**
+ * Function separates optional arguments (--name=value) from positional arguments and parses them into
+ * options structure. Unset options get their default values.
+ * 
+ * @param argc Integer value of the number of arguments
+ * @param argv Array of strings which contains the arguments
+ * @param opts (return) Parsed optional arguments
+ * @param pos_argv (return) Array of positional arguments, first one is the program name
+ * @return int Function returns number of positional arguments, or (-1) if an option is unknown
+ */
+int parse_options(int argc, char *argv[], ProjOptions *opts, char *pos_argv[])
+{
+    // default values
+    opts->arrival = NULL;
+    opts->policy = NULL;
+    opts->weights = NULL;
+    opts->topology = NULL;
+    opts->shards = 0;
+    opts->metrics = false;
+    opts->autoscale = false;
+    opts->daemon = false;
+    opts->duration = 0;
+    opts->report_interval = 0;
+    opts->office = NULL;
+    opts->clients = OFFICE_CLIENTS;
+    opts->queue_cap = NULL;
+    opts->patience = 0;
+    opts->log_format = NULL;
+    opts->export_path = NULL;
+    opts->timestamps = NULL;
+    opts->log_writer = NULL;
+    opts->log_map = false;
+    opts->report = NULL;
+    opts->report_file = NULL;
+    opts->log_reserve = 0;
+    for (int i = 0; i < SERVICE_NUM; i++) {
+        opts->service[i] = NULL;
+    }
+    opts->seed = (unsigned long)getpid();
+
+    int pos_argc = 0;
+    for (int i = 0; i < argc; i++) {
+
+        // positional argument (negative numbers start with a single '-')
+        if (i == 0 || strncmp(argv[i], "--", 2) != 0) {
+            pos_argv[pos_argc++] = argv[i];
+            continue;
+        }
+
+        // optional arguments without a value
+        if (strcmp(argv[i], "--metrics") == 0) {
+            opts->metrics = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--daemon") == 0) {
+            opts->daemon = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--log-map") == 0) {
+            opts->log_map = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--report") == 0) {
+            opts->report = "text";
+            continue;
+        }
+
+        // optional argument
+        char *value = strchr(argv[i], '=');
+        if (value == NULL) {
+            return -1;
+        }
+        value++;
+
+        if (strncmp(argv[i], "--arrival=", 10) == 0) {
+            opts->arrival = value;
+        } else if (strncmp(argv[i], "--service=", 10) == 0) {
+            // --service=N:SPEC, N is the type of the service
+            if (value[0] < '1' || value[0] > '0' + SERVICE_NUM || value[1] != ':') {
+                return -1;
+            }
+            opts->service[value[0] - '1'] = value + 2;
+        } else if (strncmp(argv[i], "--policy=", 9) == 0) {
+            opts->policy = value;
+        } else if (strncmp(argv[i], "--weights=", 10) == 0) {
+            opts->weights = value;
+        } else if (strncmp(argv[i], "--topology=", 11) == 0) {
+            opts->topology = value;
+        } else if (strncmp(argv[i], "--shards=", 9) == 0) {
+            char *endptr;
+            opts->shards = strtol(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0' || opts->shards < 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--autoscale=", 12) == 0) {
+            // --autoscale=MIN,MAX,DEPTH,COOLDOWN
+            opts->autoscale = true;
+            if (sscanf(value, "%d,%d,%d,%d", &(opts->as_min), &(opts->as_max), &(opts->as_depth), &(opts->as_cooldown)) != 4
+                || opts->as_min < 1 || opts->as_max < opts->as_min || opts->as_depth < 0 || opts->as_cooldown < 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--daemon=", 9) == 0) {
+            char *endptr;
+            opts->daemon = true;
+            opts->duration = strtol(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0' || opts->duration < 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--report-interval=", 18) == 0) {
+            char *endptr;
+            opts->report_interval = strtol(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0' || opts->report_interval < 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--office=", 9) == 0) {
+            opts->office = value;
+        } else if (strncmp(argv[i], "--clients=", 10) == 0) {
+            char *endptr;
+            opts->clients = strtol(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0' || opts->clients < 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--queue-cap=", 12) == 0) {
+            opts->queue_cap = value;
+        } else if (strncmp(argv[i], "--patience=", 11) == 0) {
+            char *endptr;
+            opts->patience = strtol(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0' || opts->patience < 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--log-format=", 13) == 0) {
+            opts->log_format = value;
+        } else if (strncmp(argv[i], "--export=", 9) == 0) {
+            opts->export_path = value;
+        } else if (strncmp(argv[i], "--timestamps=", 13) == 0) {
+            opts->timestamps = value;
+        } else if (strncmp(argv[i], "--log-writer=", 13) == 0) {
+            opts->log_writer = value;
+        } else if (strncmp(argv[i], "--log-map=", 10) == 0) {
+            char *endptr;
+            opts->log_map = true;
+            opts->log_reserve = strtol(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0' || opts->log_reserve <= 0) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--report=", 9) == 0) {
+            if (strcmp(value, "text") != 0 && strcmp(value, "json") != 0) {
+                return -1;
+            }
+            opts->report = value;
+        } else if (strncmp(argv[i], "--report-file=", 14) == 0) {
+            opts->report_file = value;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            char *endptr;
+            opts->seed = strtoul(value, &endptr, 10);
+            if (*value == '\0' || *endptr != '\0') {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+    pos_argv[pos_argc] = NULL;
+
+    return pos_argc;
+}
+
 /**
  * Function parses arguments into an array of integer values. The function also checks if the arguments
  * are in the correct format specified in [(2022/2023 - IOS – projekt 2 (synchronizace)] assigment.
@@ -266,21 +726,12 @@ int parse_arguments(int argc, char *argv[], int arg_arr[], int arg_num)
 }
 
 /**
- * Function returns random number in range <min_num, max_num>.
+ * Handler of SIGINT and SIGTERM, daemon closes the office and waits until it's empty.
  * 
- * @param min_num Minimum number in range
- * @param max_num Maximum number in range
- * @return int 
+ * @param sig Number of the signal
  */
-int ran_num(int min_num, int max_num)
+void stop_handler(int sig)
 {
-    // initialising random seed defined by process id
-    static bool init = false;
-    if (init == 0) {
-        srand(getpid());
-        init = true;
-    }
-
-    // generating random number
-    return ((rand() % (max_num - min_num + 1)) + min_num);
-}
\ No newline at end of file
+    (void)sig;
+    stop_signal = 1;
+}
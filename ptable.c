@@ -0,0 +1,363 @@
+/** @file ptable.c
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ */
+
+#include "ptable.h"
+#include "process_table.h"
+
+
+
+/* - - - - - - - - - - - - */
+/*       HANDLE DATA       */
+/* - - - - - - - - - - - - */
+
+/* Opaque handle, owner has the process table, attached handle has only the shared data */
+struct PTHandle {
+    // process table (NULL if the office is attached)
+    PTList *list;
+    // shared data of the office
+    PTListDataPtr shared_data;
+    // log file of the office
+    FILE *log_file;
+};
+
+/* Messages of status codes, indexed by PT_RENEGED - status */
+static const char *PTH_StatusStrings[] = {
+    "customer left the queue", "queue is full", "officer took a break", "office is closed", "success", "wrong argument", "table is full", 
+    "system call failed", "not found"
+};
+
+
+
+/* - - - - - - - - - - - - - - */
+/*     PTH_HANDLE FUNCTIONS    */
+/* - - - - - - - - - - - - - - */
+// Functions which create and release the handle
+
+/**
+ * Creates process table with tags "Z" (customers) and "U" (officers) and an office, the calling process becomes
+ * the init process of the table.
+ * 
+ * @param handle (return) Pointer to the new handle.
+ * @param config Configuration of the office.
+ * @return PTStatus PT_OK, PT_ERR_ARG if the configuration is wrong, PT_ERR_SYS if the shared memory wasn't created.
+ */
+PTStatus PTH_Create(PTHandle **handle, const PTHConfig *config)
+{
+    if (handle == NULL || config == NULL || config->customers < 0 || config->clients < 0 || config->capacity < 1 
+        || config->log_path == NULL) {
+        return PT_ERR_ARG;
+    }
+    if (config->name != NULL && (config->name[0] != '/' || strlen(config->name) >= PT_SEG_NAME_SIZE - 8)) {
+        return PT_ERR_ARG;
+    }
+
+    // errors are reported by status codes, modules don't print them
+    DS_Quiet = true;
+
+    PTHandle *h = calloc(1, sizeof(PTHandle));
+    if (h == NULL) {
+        return PT_ERR_SYS;
+    }
+
+    // log is appended, so external clients can write into it
+    h->log_file = fopen(config->log_path, "w");
+    if (h->log_file == NULL) {
+        free(h);
+        return PT_ERR_SYS;
+    }
+    setbuf(h->log_file, NULL);
+    fcntl(fileno(h->log_file), F_SETFL, O_APPEND);
+
+    char *keys[2] = {"Z", "U"};
+    size_t sizes[2] = {config->capacity, config->capacity};
+    h->list = PT_InitNamed(2, keys, sizes, config->name);
+    if (h->list == NULL) {
+        fclose(h->log_file);
+        free(h);
+        return PT_ERR_SYS;
+    }
+    h->shared_data = h->list->shared_data;
+
+    int err_ret = SM_CounterInit(h->shared_data);
+    err_ret += SM_OfficeInit(h->shared_data, config->customers, config->seed);
+    err_ret += SM_OfficeSetLog(h->shared_data, config->log_path);
+    if (config->clients > 0) {
+        err_ret += SM_OfficeSetClients(h->shared_data, config->clients);
+    }
+    if (err_ret != 0) {
+        PTH_Release(&h);
+        return PT_ERR_SYS;
+    }
+
+    *handle = h;
+    return PT_OK;
+}
+
+/**
+ * Attaches named office created by another program, only customer functions can be used with the handle.
+ * 
+ * @param handle (return) Pointer to the new handle.
+ * @param name Name of the office.
+ * @return PTStatus PT_OK, PT_ERR_NOT_FOUND if the office doesn't exist, PT_ERR_SYS if it can't be mapped.
+ */
+PTStatus PTH_Attach(PTHandle **handle, const char *name)
+{
+    if (handle == NULL || name == NULL) {
+        return PT_ERR_ARG;
+    }
+
+    // errors are reported by status codes, modules don't print them
+    DS_Quiet = true;
+
+    PTHandle *h = calloc(1, sizeof(PTHandle));
+    if (h == NULL) {
+        return PT_ERR_SYS;
+    }
+
+    h->shared_data = SM_OfficeAttach(name);
+    if (h->shared_data == NULL) {
+        free(h);
+        return PT_ERR_NOT_FOUND;
+    }
+    h->log_file = fopen(h->shared_data->office.log_path, "a");
+    if (h->log_file == NULL) {
+        SM_OfficeDetach(h->shared_data);
+        free(h);
+        return PT_ERR_SYS;
+    }
+    setbuf(h->log_file, NULL);
+
+    *handle = h;
+    return PT_OK;
+}
+
+/**
+ * Destroys the office and the process table (init process), detaches the office (attached handle), processes
+ * forked from the init process only free their handle.
+ * 
+ * @param handle Pointer to the handle, it's set to NULL.
+ * @return PTStatus PT_OK, PT_ERR_SYS if something wasn't released.
+ */
+PTStatus PTH_Release(PTHandle **handle)
+{
+    if (handle == NULL || *handle == NULL) {
+        return PT_ERR_ARG;
+    }
+
+    PTHandle *h = *handle;
+    int err_ret = 0;
+    if (h->list == NULL) {
+        err_ret += SM_OfficeDetach(h->shared_data);
+    } else if (is_init_pid(h->list)) {
+        err_ret += SM_CounterDestroy(h->shared_data);
+        err_ret += SM_OfficeDestroy(h->shared_data);
+        err_ret += PT_Destroy(&(h->list));
+    }
+    err_ret += fclose(h->log_file);
+    free(h);
+    *handle = NULL;
+
+    return (err_ret == 0) ? PT_OK : PT_ERR_SYS;
+}
+
+/**
+ * Sets an option of the office, keys are "policy", "weights", "topology" (value "name" or "name:shards")
+ * and "service1".."service3" (see DS_ServiceInit()).
+ * 
+ * @param handle Handle of the init process.
+ * @param key Name of the option.
+ * @param value Value of the option.
+ * @return PTStatus PT_OK, PT_ERR_ARG if the option or it's value is wrong.
+ */
+PTStatus PTH_Set(PTHandle *handle, const char *key, const char *value)
+{
+    if (handle == NULL || handle->list == NULL || key == NULL || value == NULL) {
+        return PT_ERR_ARG;
+    }
+
+    int err_ret = -1;
+    if (strcmp(key, "policy") == 0) {
+        err_ret = SM_OfficeSetPolicy(handle->shared_data, value);
+    } else if (strcmp(key, "weights") == 0) {
+        err_ret = SM_OfficeSetWeights(handle->shared_data, value);
+    } else if (strcmp(key, "topology") == 0) {
+        // topology name and optional number of shards
+        char name[KEY_MAX_SIZE];
+        int shards = 1;
+        if (sscanf(value, "%[^:]:%d", name, &shards) < 1) {
+            return PT_ERR_ARG;
+        }
+        err_ret = SM_OfficeSetTopology(handle->shared_data, name, shards);
+    } else if (strncmp(key, "service", 7) == 0 && key[7] >= '1' && key[7] <= '0' + SERVICE_NUM && key[8] == '\0') {
+        err_ret = SM_OfficeSetService(handle->shared_data, key[7] - '0', value);
+    }
+    return (err_ret == 0) ? PT_OK : PT_ERR_ARG;
+}
+
+/**
+ * Returns message of a status code.
+ * 
+ * @param status Status code.
+ * @return const char* Message.
+ */
+const char *PTH_StatusString(PTStatus status)
+{
+    if (status < PT_ERR_NOT_FOUND || status > PT_RENEGED) {
+        return "unknown status";
+    }
+    return PTH_StatusStrings[PT_RENEGED - status];
+}
+
+
+
+/* - - - - - - - - - - - - - - - */
+/*     PTH_PROCESS FUNCTIONS     */
+/* - - - - - - - - - - - - - - - */
+// Functions which work with processes of the table
+
+/**
+ * Forks a process with the given tag, only the init process can spawn processes.
+ * 
+ * @param handle Handle of the init process.
+ * @param tag Tag of the new process.
+ * @param pid (return) Pid of the new process in the init process, 0 in the new process.
+ * @return PTStatus PT_OK, PT_ERR_FULL if the tag can't grow, PT_ERR_SYS if fork failed.
+ */
+PTStatus PTH_Spawn(PTHandle *handle, const char *tag, pid_t *pid)
+{
+    if (handle == NULL || handle->list == NULL || tag == NULL || pid == NULL || strlen(tag) >= KEY_MAX_SIZE) {
+        return PT_ERR_ARG;
+    }
+
+    char key[KEY_MAX_SIZE];
+    strcpy(key, tag);
+    pid_t ret = PT_ProcessCreate(handle->list, key);
+    if (ret < 0) {
+        return (PTStatus)ret;
+    }
+    *pid = ret;
+    return PT_OK;
+}
+
+/**
+ * Waits for all processes spawned by the init process.
+ * 
+ * @param handle Handle of the init process.
+ * @return PTStatus PT_OK, PT_ERR_SYS if wait failed.
+ */
+PTStatus PTH_WaitAll(PTHandle *handle)
+{
+    if (handle == NULL || handle->list == NULL) {
+        return PT_ERR_ARG;
+    }
+    return (PT_ProcessWaitAll(handle->list) == 0) ? PT_OK : PT_ERR_SYS;
+}
+
+/**
+ * Returns slot of the calling process in it's tag, it can be used as a customer record of processes which live
+ * at the same time.
+ * 
+ * @return int Slot of the process, (-1) in the init process.
+ */
+int PTH_Slot(void)
+{
+    return PT_ProcessSlot();
+}
+
+
+
+/* - - - - - - - - - - - - - - - */
+/*     PTH_OFFICE FUNCTIONS      */
+/* - - - - - - - - - - - - - - - */
+// Functions of customers and officers, they don't print anything except the log
+
+/**
+ * Prints a numbered line into the log.
+ * 
+ * @param handle Handle of the office.
+ * @param message Line without the number.
+ * @return PTStatus PT_OK, PT_ERR_SYS if the counter can't be locked.
+ */
+PTStatus PTH_Log(PTHandle *handle, const char *message)
+{
+    char buffer[BUFFER_SIZE];
+    snprintf(buffer, BUFFER_SIZE, "%s", message);
+    return (PTStatus)SM_CounterPrint(handle->shared_data, handle->log_file, buffer);
+}
+
+/**
+ * Customer gets a service in the office (see SM_OfficeService()).
+ * 
+ * @param handle Handle of the office.
+ * @param id Number of the customer printed in the log.
+ * @param record Customer record.
+ * @param type_of_service Type of the service <1, 3>.
+ * @return PTStatus PT_OK if the customer was served, PT_CLOSED if the office is closed, PT_REJECTED if the queue
+ *                  is full, PT_RENEGED if the customer ran out of patience, PT_ERR_ARG.
+ */
+PTStatus PTH_Service(PTHandle *handle, int id, int record, int type_of_service)
+{
+    return (PTStatus)SM_OfficeService(handle->shared_data, handle->log_file, id, record, type_of_service);
+}
+
+/**
+ * Officer serves one customer or takes a break (see SM_OfficeServe()).
+ * 
+ * @param handle Handle of the init process or a process forked from it.
+ * @param id Number of the officer.
+ * @param max_break_time Max time of a break in miliseconds.
+ * @return PTStatus PT_OK if a customer was served, PT_BREAK, PT_CLOSED if the office is closed and empty.
+ */
+PTStatus PTH_Serve(PTHandle *handle, int id, unsigned int max_break_time)
+{
+    return (PTStatus)SM_OfficeServe(handle->shared_data, handle->log_file, id, max_break_time);
+}
+
+/**
+ * Closes the office, customers who didn't enter won't get in.
+ * 
+ * @param handle Handle of the office.
+ * @return PTStatus PT_OK
+ */
+PTStatus PTH_Close(PTHandle *handle)
+{
+    SM_OfficeClose(handle->shared_data);
+    return PT_OK;
+}
+
+/**
+ * Returns number of customers waiting in the office.
+ * 
+ * @param handle Handle of the office.
+ * @return int Number of waiting customers.
+ */
+int PTH_Waiting(PTHandle *handle)
+{
+    return SM_OfficeWaiting(handle->shared_data);
+}
+
+/**
+ * Takes a free record of an external client.
+ * 
+ * @param handle Handle of the office.
+ * @param record (return) Index of the record.
+ * @return PTStatus PT_OK, PT_ERR_FULL if all the records are taken.
+ */
+PTStatus PTH_RecordAcquire(PTHandle *handle, int *record)
+{
+    *record = SM_OfficeRecordAcquire(handle->shared_data);
+    return (*record == -1) ? PT_ERR_FULL : PT_OK;
+}
+
+/**
+ * Returns record of an external client.
+ * 
+ * @param handle Handle of the office.
+ * @param record Index of the record.
+ */
+void PTH_RecordRelease(PTHandle *handle, int record)
+{
+    SM_OfficeRecordRelease(handle->shared_data, record);
+}
@@ -0,0 +1,142 @@
+/** @file ptable.h
+ *  @author Nikolas Nosál (xnosal01@stud.fit.vutbr.cz)
+ *  @date 2023-04-24
+ *  Stable interface of the process table library (libptable.a, libptable.so). The process table, the counter and 
+ *  the office are hidden behind an opaque handle, the functions return status codes and don't print anything.
+ */
+#pragma once
+
+
+
+/* - - - - - - - - */
+/*    LIBRARIES    */
+/* - - - - - - - - */
+
+// standart libraries
+#include <stdio.h>
+
+// linux libs
+#include <sys/types.h>
+
+
+
+/* - - - - - - - - - - - -*/
+/*    TYPE DEFINITIONS    */
+/* - - - - - - - - - - - -*/
+
+/* Constant macros */
+#define PTH_VERSION 1       // version of the interface, changes only when the interface breaks
+
+
+
+/* - - - - - - - - - - - */
+/*         ENUMS         */
+/* - - - - - - - - - - - */
+
+/* Status codes of the library, negative codes are errors */
+typedef enum {
+    // success
+    PT_OK = 0,
+    // office is closed (customer didn't enter, officer has nobody else to serve)
+    PT_CLOSED = 1,
+    // officer had nobody to serve, so he took a break
+    PT_BREAK = 2,
+    // queue of the service was full, customer didn't enter
+    PT_REJECTED = 3,
+    // customer ran out of patience and left the queue before he was called
+    PT_RENEGED = 4,
+    // wrong argument
+    PT_ERR_ARG = -1,
+    // table, tag or records are full
+    PT_ERR_FULL = -2,
+    // system call failed, errno is set
+    PT_ERR_SYS = -3,
+    // office or process doesn't exist
+    PT_ERR_NOT_FOUND = -4,
+} PTStatus;
+
+
+
+/* - - - - - - - - - - - - */
+/*       HANDLE DATA       */
+/* - - - - - - - - - - - - */
+
+/* Opaque handle of a process table with an office */
+typedef struct PTHandle PTHandle;
+
+/* Configuration of a new office */
+typedef struct PTHConfig {
+    // name of the shared memory ("/name"), NULL if only forked processes use the office
+    const char *name;
+    // number of customer records, numbers of customers are in interval <0, customers)
+    int customers;
+    // number of records of external clients (named office)
+    int clients;
+    // initial capacity of process tags, they grow when they are full
+    int capacity;
+    // seed of random number generators
+    unsigned long seed;
+    // path of the log file, it's truncated
+    const char *log_path;
+} PTHConfig;
+
+
+
+/* - - - - - - - - - - - - - - */
+/*     PTH_HANDLE FUNCTIONS    */
+/* - - - - - - - - - - - - - - */
+
+/* Creates process table with an office, the calling process becomes the init process */
+PTStatus PTH_Create(PTHandle **handle, const PTHConfig *config);
+
+/* Attaches named office created by another program */
+PTStatus PTH_Attach(PTHandle **handle, const char *name);
+
+/* Destroys the office (init process) or detaches it (attached handle) */
+PTStatus PTH_Release(PTHandle **handle);
+
+/* Sets option of the office (policy, weights, topology, service1..service3), before processes are spawned */
+PTStatus PTH_Set(PTHandle *handle, const char *key, const char *value);
+
+/* Returns message of a status code */
+const char *PTH_StatusString(PTStatus status);
+
+
+/* - - - - - - - - - - - - - - - */
+/*     PTH_PROCESS FUNCTIONS     */
+/* - - - - - - - - - - - - - - - */
+
+/* Forks a process with the given tag, pid is 0 in the new process */
+PTStatus PTH_Spawn(PTHandle *handle, const char *tag, pid_t *pid);
+
+/* Waits for all spawned processes */
+PTStatus PTH_WaitAll(PTHandle *handle);
+
+/* Slot of the calling process in it's tag, (-1) in the init process */
+int PTH_Slot(void);
+
+
+/* - - - - - - - - - - - - - - - */
+/*     PTH_OFFICE FUNCTIONS      */
+/* - - - - - - - - - - - - - - - */
+
+/* Prints a numbered line into the log */
+PTStatus PTH_Log(PTHandle *handle, const char *message);
+
+/* Customer gets a service, record is his customer record (process number, slot or acquired record) */
+PTStatus PTH_Service(PTHandle *handle, int id, int record, int type_of_service);
+
+/* Officer serves one customer or takes a break */
+PTStatus PTH_Serve(PTHandle *handle, int id, unsigned int max_break_time);
+
+/* Closes the office */
+PTStatus PTH_Close(PTHandle *handle);
+
+/* Number of waiting customers */
+int PTH_Waiting(PTHandle *handle);
+
+/* Takes a free record of an external client */
+PTStatus PTH_RecordAcquire(PTHandle *handle, int *record);
+
+/* Returns record of an external client */
+void PTH_RecordRelease(PTHandle *handle, int record);
@@ -10,6 +10,12 @@ Z_in_n = 0
 Z_called = r"^[0-9][0-9]*: Z [0-9][0-9]*: called by office worker$"
 Z_called_n = 0
 
+Z_rejected = r"^[0-9][0-9]*: Z [0-9][0-9]*: rejected from a service [1-3]$"
+Z_rejected_n = 0
+
+Z_reneged = r"^[0-9][0-9]*: Z [0-9][0-9]*: leaving the queue of a service [1-3]$"
+Z_reneged_n = 0
+
 Z_home = r"^[0-9][0-9]*: Z [0-9][0-9]*: going home$"
 Z_home_n = 0
 
@@ -42,6 +48,10 @@ with open('proj2.out', 'r') as f:
             Z_in_n += 1
         elif re.search(Z_called, line):
             Z_called_n += 1
+        elif re.search(Z_rejected, line):
+            Z_rejected_n += 1
+        elif re.search(Z_reneged, line):
+            Z_reneged_n += 1
         elif re.search(Z_home, line):
             Z_home_n += 1
         elif re.search(U_start, line):
@@ -97,7 +107,8 @@ if not (U_break_n == U_breakF_n):
     print("ERROR: U started more breaks than finished")
     print("U started " + str(U_break_n) + " breaks")
     print("U finished " + str(U_breakF_n) + " breaks")
-if not (Z_in_n == Z_called_n):
+if not (Z_in_n == Z_called_n + Z_reneged_n):
     print("ERROR: Called less Z than entered service queues")
     print("Z entered: " + str(Z_in_n))
-    print("Z called: " + str(Z_called_n))
\ No newline at end of file
+    print("Z called: " + str(Z_called_n))
+    print("Z left the queue: " + str(Z_reneged_n))
\ No newline at end of file
@@ -30,15 +30,8 @@ function show_help(){
         Tato varianta se použije automaticky, pokud v adresáři není soubor kontrol-vystupu.py
 
     [${GREEN}-c${NC}]
-        Rychlá varianta kontroly výstupu implementovaná v ${GREEN}C${NC}.
-        První číslo v Line format erroru, je číslo řádku v kódu, který neodpovídá formátu.
-        * Řádky delší než 64 znaků rozdělí na 2 (takže nespadne, ale bere je jako chybu), ale pokud
-            máte korektní řešení, neměl by žádný řádek být tak dlouhý, dokud teda nemáte ve výstupu více
-            jak 100M řádků.
-        * K rychlosti: nečekal, jsem takový speedup, ale dal jsem původnímu skriptu soubor s 1.7M řádky a ani
-            po 15 minutách nevyhodil výsledek. C to zvládlo do 200 ms. (Hlavně protože to prostě se rovnou rozhoduje
-            kam v kódu to půjde a navíc ten originální skript nic víc než kontrolu formátu řádků nedělá)
-        Jo a není to hezký kód :smrckaBat:, pokud bude nějaký problém, tak mě tagněte na discordu  @Tiger.CZ#1728
+        Rychlá varianta kontroly výstupu implementovaná v ${GREEN}C${NC} (proj2-check, vytvoří ho make v kořeni projektu).
+        Zná i řádky voleb --queue-cap a --patience, které kontrola-vystupu.c hlásí jako chybu formátu.
 
     [${GREEN}-e${NC}]
         Zapne ${GREEN}E${NC}xtrémní variantu testů.
@@ -72,9 +65,9 @@ proj2out_check() {
         fi
     elif [[ $C == 1 ]]
     then
-        if [[ ! -f "./kontrola-vystupu.c" ]]
+        if [[ ! -f "./proj2-check" ]]
         then
-            echo -e  "${YELLOW}WARNING: File ./kontrola-vystupu.c not found, running with slower kontrola-vystupu.sh!${NC}"
+            echo -e  "${YELLOW}WARNING: File ./proj2-check not found, running with slower kontrola-vystupu.sh!${NC}"
             if [[ ! -f "./kontrola-vystupu.sh" ]]
             then
                 echo -e  "${RED}ERROR: File ./kontrola-vystupu.sh not found!${NC}"
@@ -86,7 +79,7 @@ proj2out_check() {
             fi
         else
             echo -e "${YELLOW}"
-            cat ./proj2.out | ./kontrola-vystupu.c
+            cat ./proj2.out | ./proj2-check -
             echo -e "${NC}"
         fi
     else